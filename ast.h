@@ -0,0 +1,188 @@
+/*
+    Árvore sintática do CePe, montada pelas ações semânticas do PARSE.
+
+    Os nós ficam todos seguidos num vetor (a arena da unidade de compilação)
+    e se referem uns aos outros por índice; os filhos de cada nó são um
+    trecho contíguo de outro vetor. Montar a árvore de um arquivo grande não
+    faz um new por nó, e liberar é esvaziar os dois vetores de uma vez, que
+    continuam com a capacidade para o próximo arquivo
+*/
+
+#ifndef CEPE_AST_H
+#define CEPE_AST_H
+
+#include <vector>
+#include <cstdint>
+#include "lexer.h"
+#include "parser_lr.h"
+
+using namespace std;
+
+// Valores especiais de NoAST::regra
+const int32_t FOLHA = -1;    // Token com lexema que não é identificador
+const int32_t LISTA = -2;    // Lista achatada (não terminal marcado com %lista)
+const int32_t FOLHA_ID = -3; // Identificador
+
+/*
+    Nas folhas de identificador o tipo do token já é dado por FOLHA_ID, e
+    simbolo guarda o id do identificador na TabelaSimbolos, para que quem
+    usa a árvore compare identificadores como inteiros
+*/
+struct NoAST
+{
+    int32_t regra;    // Regra que formou o nó, ou FOLHA/LISTA/FOLHA_ID
+    int32_t simbolo;  // Não terminal do nó, tipo do token nas folhas ou id do símbolo em FOLHA_ID
+    uint32_t inicio;  // Primeiro filho em ArvoreAST::filhos, ou deslocamento do lexema nas folhas
+    uint32_t tamanho; // Quantidade de filhos, ou tamanho do lexema nas folhas
+};
+
+// Só os tokens que carregam um lexema viram folhas; pontuação, operadores
+// e palavras-chave já estão implícitos na regra do nó pai
+inline bool tokenComValor(int tipo)
+{
+    return tipo == Tokens::ID || tipo == Tokens::INT_NUM || tipo == Tokens::FLOAT_NUM || tipo == Tokens::STRING_LIT;
+}
+
+struct ArvoreAST
+{
+    vector<NoAST> nos;
+    vector<uint32_t> filhos;
+    uint32_t raiz = 0;
+
+    void limpar()
+    {
+        nos.clear();
+        filhos.clear();
+        raiz = 0;
+    }
+
+    bool folha(uint32_t no) const { return nos[no].regra == FOLHA || nos[no].regra == FOLHA_ID; }
+
+    // Tipo do token de uma folha e, se ela for um identificador, o seu id na TabelaSimbolos (senão -1)
+    int tipoFolha(uint32_t no) const { return nos[no].regra == FOLHA_ID ? int(Tokens::ID) : nos[no].simbolo; }
+    int simboloFolha(uint32_t no) const { return nos[no].regra == FOLHA_ID ? nos[no].simbolo : -1; }
+
+    const uint32_t *primeiroFilho(uint32_t no) const { return filhos.data() + nos[no].inicio; }
+    uint32_t numFilhos(uint32_t no) const { return folha(no) ? 0 : nos[no].tamanho; }
+};
+
+// Valor de um símbolo da pilha que não virou nada (um token sem lexema)
+const int SEM_VALOR = INT32_MIN;
+
+/*
+    Ações semânticas que montam uma ArvoreAST. Cada símbolo na pilha do
+    parser tem um valor: o índice de um nó, SEM_VALOR ou uma lista ainda
+    aberta (-1 - índice em abertas).
+
+    Os itens de uma lista recursiva à esquerda (comandos -> comandos comando)
+    vão se juntando em pendentes e só são copiados para filhos quando a lista
+    vira filho de outro nó, então a lista inteira fica num trecho só. As
+    listas abertas formam uma pilha: uma lista aberta depois de outra está
+    acima dela na pilha do parser e é fechada antes
+*/
+class ConstrutorAST
+{
+public:
+    explicit ConstrutorAST(ArvoreAST &arvore) : arvore(arvore) {}
+
+    void comecar()
+    {
+        arvore.limpar();
+        valores.limpar();
+        valores.empilhar(SEM_VALOR); // O do estado 0
+        abertas.clear();
+        pendentes.clear();
+    }
+
+    void shift(const Token &tk)
+    {
+        if (!tokenComValor(tk.tipo))
+        {
+            valores.empilhar(SEM_VALOR);
+            return;
+        }
+
+        valores.empilhar(arvore.nos.size());
+        if (tk.tipo == Tokens::ID)
+            arvore.nos.push_back({FOLHA_ID, tk.simbolo, tk.inicio, tk.tamanho});
+        else
+            arvore.nos.push_back({FOLHA, tk.tipo, tk.inicio, tk.tamanho});
+    }
+
+    void reduce(int regra, int ladoEsquerdo, int tamanho, AcaoSemantica acao)
+    {
+        int *corpo = valores.ultimos(tamanho);
+
+        if (acao == REPASSAR)
+            return; // O valor do único filho fica onde está
+
+        // Fecha as listas que viram filhos, da mais recente para a mais antiga.
+        // O primeiro símbolo de X -> X ... é a própria lista que continua
+        const int primeiro = acao == ESTENDER_LISTA ? 1 : 0;
+        for (int i = tamanho - 1; i >= primeiro; i--)
+            corpo[i] = fechar(corpo[i]);
+
+        int valor;
+
+        if (acao == CRIAR_NO)
+        {
+            valor = arvore.nos.size();
+            arvore.nos.push_back({regra, ladoEsquerdo, uint32_t(arvore.filhos.size()), 0});
+            for (int i = 0; i < tamanho; i++)
+                if (corpo[i] != SEM_VALOR)
+                    arvore.filhos.push_back(corpo[i]);
+            arvore.nos.back().tamanho = arvore.filhos.size() - arvore.nos.back().inicio;
+        }
+        else
+        {
+            if (acao == ABRIR_LISTA)
+            {
+                abertas.push_back({ladoEsquerdo, uint32_t(pendentes.size())});
+                valor = -int(abertas.size());
+            }
+            else
+                valor = corpo[0];
+
+            for (int i = primeiro; i < tamanho; i++)
+                if (corpo[i] != SEM_VALOR)
+                    pendentes.push_back(corpo[i]);
+        }
+
+        valores.desempilhar(tamanho);
+        valores.empilhar(valor);
+    }
+
+    void aceitar() { arvore.raiz = fechar(valores.topo()); }
+
+private:
+    struct ListaAberta
+    {
+        int32_t simbolo;
+        uint32_t inicio; // Primeiro item em pendentes
+    };
+
+    // Transforma uma lista aberta num nó LISTA; outros valores passam direto
+    int fechar(int valor)
+    {
+        if (valor >= 0 || valor == SEM_VALOR)
+            return valor;
+
+        // Só a lista do topo pode estar sendo fechada
+        const ListaAberta lista = abertas.back();
+        abertas.pop_back();
+
+        const int no = arvore.nos.size();
+        arvore.nos.push_back({LISTA, lista.simbolo, uint32_t(arvore.filhos.size()), uint32_t(pendentes.size() - lista.inicio)});
+        arvore.filhos.insert(arvore.filhos.end(), pendentes.begin() + lista.inicio, pendentes.end());
+        pendentes.resize(lista.inicio);
+
+        return no;
+    }
+
+    ArvoreAST &arvore;
+    PilhaLR valores; // Paralela à pilha de estados
+    vector<ListaAberta> abertas;
+    vector<uint32_t> pendentes;
+};
+
+#endif
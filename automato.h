@@ -0,0 +1,392 @@
+/*
+    Autômato finito determinístico do lexer, construído em tempo de compilação
+    a partir de uma especificação declarativa dos tokens.
+
+    Cada regra tem um padrão e o tipo de token que ele produz. Um padrão é uma
+    sequência de átomos, cada um podendo ser seguido de *, + ou ?:
+        c         um byte literal (\xHH, \t, \n e \c para escapar)
+        [a-z...]  uma classe de bytes, com faixas; [^...] é o complemento
+
+    A construção é a de Glushkov (cada átomo vira uma posição) seguida da
+    construção de subconjuntos. Os bytes são agrupados em classes que nenhum
+    padrão distingue, então a tabela de transições fica pequena. Em empates
+    de tamanho vence a regra que aparece primeiro
+*/
+
+#ifndef CEPE_AUTOMATO_H
+#define CEPE_AUTOMATO_H
+
+#include <cstdint>
+
+using namespace std;
+
+// Tipos especiais que uma regra pode produzir
+const int TOKEN_IGNORADO = -2;  // Reconhecido e descartado (espaços)
+const int TOKEN_CARACTERE = -3; // O tipo do token é o próprio byte
+
+struct RegraLexica
+{
+    const char *padrao;
+    int tipo;
+};
+
+constexpr int MAX_ATOMOS = 64; // Cabem numa máscara de 64 bits
+constexpr int MAX_ESTADOS_AUTOMATO = 64;
+constexpr int MAX_CLASSES_BYTES = 64;
+
+constexpr uint8_t ESTADO_MORTO = 0;
+constexpr uint8_t ESTADO_INICIAL = 1;
+
+// Estados que ficam em laço numa dessas classes podem ser acelerados com varredura.h
+enum Aceleracao : uint8_t
+{
+    SEM_ACELERACAO,
+    ACELERAR_STRING,       // Tudo menos aspas
+    ACELERAR_ALFANUMERICO, // Letras e dígitos ASCII
+    ACELERAR_DIGITOS,
+    ACELERAR_ESPACOS // Espaço, tab e quebra de linha
+};
+
+struct ConjuntoBytes
+{
+    uint64_t bits[4] = {0, 0, 0, 0};
+
+    constexpr void adicionar(unsigned c) { bits[c >> 6] |= uint64_t(1) << (c & 63); }
+    constexpr bool contem(unsigned c) const { return (bits[c >> 6] >> (c & 63)) & 1; }
+
+    constexpr void inverter()
+    {
+        for (int i = 0; i < 4; i++)
+            bits[i] = ~bits[i];
+    }
+};
+
+struct Atomo
+{
+    ConjuntoBytes bytes;
+    char repeticao = 0; // 0 (exatamente uma vez), '*', '+' ou '?'
+    int regra = 0;
+};
+
+struct Automato
+{
+    int numEstados = 0; // Contando o estado morto
+    int numClasses = 0;
+    uint8_t classe[256] = {};
+    uint8_t transicao[MAX_ESTADOS_AUTOMATO][MAX_CLASSES_BYTES] = {};
+    uint8_t porByte[MAX_ESTADOS_AUTOMATO][256] = {}; // transicao já expandida por byte, usada pelo lexer
+    int16_t aceita[MAX_ESTADOS_AUTOMATO] = {}; // Tipo do token, ou -1
+    uint8_t aceleracao[MAX_ESTADOS_AUTOMATO] = {};
+
+    const char *erro = nullptr; // Preenchido se a especificação não puder ser compilada
+};
+
+// ===== LEITURA DOS PADRÕES =====
+
+constexpr unsigned valorHex(char c)
+{
+    return c >= '0' && c <= '9' ? c - '0' : c >= 'a' && c <= 'f' ? c - 'a' + 10
+                                                                 : c - 'A' + 10;
+}
+
+// Lê um byte do padrão, tratando os escapes, e avança i
+constexpr unsigned lerByte(const char *s, int &i)
+{
+    if (s[i] != '\\')
+        return (unsigned char)s[i++];
+
+    i++;
+    const char c = s[i++];
+
+    if (c == 'x')
+    {
+        const unsigned valor = valorHex(s[i]) * 16 + valorHex(s[i + 1]);
+        i += 2;
+        return valor;
+    }
+    if (c == 't')
+        return '\t';
+    if (c == 'n')
+        return '\n';
+
+    return (unsigned char)c;
+}
+
+// Acrescenta os átomos de um padrão a partir de atomos[n] e retorna o novo total
+constexpr int lerAtomos(const char *s, int regra, Atomo *atomos, int n, const char *&erro)
+{
+    int i = 0;
+
+    while (s[i] != 0)
+    {
+        if (n == MAX_ATOMOS)
+        {
+            erro = "Átomos demais na especificação do lexer";
+            return n;
+        }
+
+        Atomo atomo;
+        atomo.regra = regra;
+
+        if (s[i] == '[')
+        {
+            i++;
+
+            bool negado = false;
+            if (s[i] == '^')
+            {
+                negado = true;
+                i++;
+            }
+
+            while (s[i] != ']')
+            {
+                if (s[i] == 0)
+                {
+                    erro = "Classe de bytes sem ]";
+                    return n;
+                }
+
+                const unsigned lo = lerByte(s, i);
+                unsigned hi = lo;
+
+                if (s[i] == '-' && s[i + 1] != ']')
+                {
+                    i++;
+                    hi = lerByte(s, i);
+                }
+
+                for (unsigned c = lo; c <= hi; c++)
+                    atomo.bytes.adicionar(c);
+            }
+            i++;
+
+            if (negado)
+                atomo.bytes.inverter();
+        }
+        else
+            atomo.bytes.adicionar(lerByte(s, i));
+
+        if (s[i] == '*' || s[i] == '+' || s[i] == '?')
+            atomo.repeticao = s[i++];
+
+        atomos[n++] = atomo;
+    }
+
+    return n;
+}
+
+// ===== CONSTRUÇÃO =====
+
+constexpr bool anulavel(const Atomo &atomo) { return atomo.repeticao == '*' || atomo.repeticao == '?'; }
+
+// Verifica se todos os bytes do conjunto levam o estado para ele mesmo
+constexpr bool lacoEm(const Automato &a, int estado, const ConjuntoBytes &bytes)
+{
+    for (unsigned c = 0; c < 256; c++)
+        if (bytes.contem(c) && a.transicao[estado][a.classe[c]] != estado)
+            return false;
+
+    return true;
+}
+
+constexpr Automato construirAutomato(const RegraLexica *regras, int numRegras)
+{
+    Automato a;
+
+    // 1. Átomos de todas as regras, lembrando onde cada regra começa e termina
+    Atomo atomos[MAX_ATOMOS] = {};
+    int inicioRegra[MAX_ATOMOS + 1] = {};
+    int numAtomos = 0;
+
+    for (int r = 0; r < numRegras; r++)
+    {
+        inicioRegra[r] = numAtomos;
+        numAtomos = lerAtomos(regras[r].padrao, r, atomos, numAtomos, a.erro);
+        if (a.erro != nullptr)
+            return a;
+    }
+    inicioRegra[numRegras] = numAtomos;
+
+    // 2. Conjuntos de Glushkov: primeiros átomos de cada regra, átomos que podem
+    // seguir cada átomo e átomos que podem terminar a regra
+    uint64_t primeiros = 0;
+    uint64_t seguintes[MAX_ATOMOS] = {};
+    uint64_t finais = 0;
+
+    for (int r = 0; r < numRegras; r++)
+    {
+        const int ini = inicioRegra[r], fim = inicioRegra[r + 1];
+
+        for (int k = ini; k < fim; k++)
+        {
+            primeiros |= uint64_t(1) << k;
+            if (!anulavel(atomos[k]))
+                break;
+        }
+
+        for (int k = ini; k < fim; k++)
+        {
+            if (atomos[k].repeticao == '*' || atomos[k].repeticao == '+')
+                seguintes[k] |= uint64_t(1) << k;
+
+            bool restoAnulavel = true;
+            for (int m = k + 1; m < fim; m++)
+            {
+                seguintes[k] |= uint64_t(1) << m;
+                if (!anulavel(atomos[m]))
+                {
+                    restoAnulavel = false;
+                    break;
+                }
+            }
+
+            if (restoAnulavel)
+                finais |= uint64_t(1) << k;
+        }
+    }
+
+    // 3. Classes de bytes: bytes contidos exatamente nos mesmos átomos
+    uint64_t assinatura[256] = {};
+    uint64_t assinaturaClasse[MAX_CLASSES_BYTES] = {};
+    unsigned representante[MAX_CLASSES_BYTES] = {};
+
+    for (unsigned c = 0; c < 256; c++)
+    {
+        for (int k = 0; k < numAtomos; k++)
+            if (atomos[k].bytes.contem(c))
+                assinatura[c] |= uint64_t(1) << k;
+
+        int classe = 0;
+        while (classe < a.numClasses && assinaturaClasse[classe] != assinatura[c])
+            classe++;
+
+        if (classe == a.numClasses)
+        {
+            if (a.numClasses == MAX_CLASSES_BYTES)
+            {
+                a.erro = "Classes de bytes demais na especificação do lexer";
+                return a;
+            }
+
+            assinaturaClasse[classe] = assinatura[c];
+            representante[classe] = c;
+            a.numClasses++;
+        }
+
+        a.classe[c] = classe;
+    }
+
+    // 4. Construção de subconjuntos. Cada estado é o conjunto de átomos que
+    // acabaram de ser lidos; o estado inicial é tratado à parte
+    uint64_t conjuntoEstado[MAX_ESTADOS_AUTOMATO] = {};
+    a.numEstados = 2; // Estado morto e estado inicial
+    a.aceita[ESTADO_MORTO] = -1;
+    a.aceita[ESTADO_INICIAL] = -1;
+
+    for (int estado = ESTADO_INICIAL; estado < a.numEstados; estado++)
+    {
+        uint64_t possiveis = 0;
+
+        if (estado == ESTADO_INICIAL)
+            possiveis = primeiros;
+        else
+            for (int k = 0; k < numAtomos; k++)
+                if ((conjuntoEstado[estado] >> k) & 1)
+                    possiveis |= seguintes[k];
+
+        for (int classe = 0; classe < a.numClasses; classe++)
+        {
+            const uint64_t alvo = possiveis & assinatura[representante[classe]];
+
+            if (alvo == 0)
+            {
+                a.transicao[estado][classe] = ESTADO_MORTO;
+                continue;
+            }
+
+            int destino = ESTADO_INICIAL + 1;
+            while (destino < a.numEstados && conjuntoEstado[destino] != alvo)
+                destino++;
+
+            if (destino == a.numEstados)
+            {
+                if (a.numEstados == MAX_ESTADOS_AUTOMATO)
+                {
+                    a.erro = "Estados demais no autômato do lexer";
+                    return a;
+                }
+
+                conjuntoEstado[destino] = alvo;
+                a.numEstados++;
+
+                // Aceita o tipo da primeira regra que pode terminar aqui
+                a.aceita[destino] = -1;
+                for (int k = 0; k < numAtomos; k++)
+                    if (((alvo & finais) >> k) & 1)
+                    {
+                        a.aceita[destino] = regras[atomos[k].regra].tipo;
+                        break;
+                    }
+            }
+
+            a.transicao[estado][classe] = destino;
+        }
+    }
+
+    // 5. O laço do lexer não volta atrás: ele para no primeiro byte sem
+    // transição e aceita o estado atual, então todo estado alcançável precisa
+    // ser de aceitação e todo byte precisa começar algum token
+    for (int estado = ESTADO_INICIAL + 1; estado < a.numEstados; estado++)
+        if (a.aceita[estado] == -1)
+        {
+            a.erro = "Especificação do lexer exigiria voltar atrás (estado sem aceitação)";
+            return a;
+        }
+
+    for (int classe = 0; classe < a.numClasses; classe++)
+        if (a.transicao[ESTADO_INICIAL][classe] == ESTADO_MORTO)
+        {
+            a.erro = "Algum byte não começa nenhum token";
+            return a;
+        }
+
+    for (int estado = 0; estado < a.numEstados; estado++)
+        for (unsigned c = 0; c < 256; c++)
+            a.porByte[estado][c] = a.transicao[estado][a.classe[c]];
+
+    // 6. Acelerações: do maior para o menor conjunto de bytes em laço
+    ConjuntoBytes naoAspas, alfanumericos, digitos, espacos;
+
+    naoAspas.adicionar('"');
+    naoAspas.inverter();
+    for (unsigned c = '0'; c <= '9'; c++)
+    {
+        alfanumericos.adicionar(c);
+        digitos.adicionar(c);
+    }
+    for (unsigned c = 'a'; c <= 'z'; c++)
+    {
+        alfanumericos.adicionar(c);
+        alfanumericos.adicionar(c - 'a' + 'A');
+    }
+    espacos.adicionar(' ');
+    espacos.adicionar('\t');
+    espacos.adicionar('\n');
+
+    for (int estado = ESTADO_INICIAL + 1; estado < a.numEstados; estado++)
+    {
+        if (lacoEm(a, estado, naoAspas))
+            a.aceleracao[estado] = ACELERAR_STRING;
+        else if (lacoEm(a, estado, alfanumericos))
+            a.aceleracao[estado] = ACELERAR_ALFANUMERICO;
+        else if (lacoEm(a, estado, digitos))
+            a.aceleracao[estado] = ACELERAR_DIGITOS;
+        else if (lacoEm(a, estado, espacos))
+            a.aceleracao[estado] = ACELERAR_ESPACOS;
+    }
+
+    return a;
+}
+
+#endif
@@ -0,0 +1,135 @@
+/*
+    Benchmark do relexing incremental.
+    Aplica edições aleatórias na fonte, atualiza os tokens com relexar() e
+    compara cada resultado com o de reconhecer a fonte editada inteira de novo.
+
+    As edições trocam alguns bytes por pedaços de código, aspas, quebras de
+    linha e bytes UTF-8 válidos e inválidos, para exercitar as strings e o
+    alcance do lexer. Sem arquivo, usa um programa sintético de programas.h.
+
+    Compilar: make bench/lexer_incremental
+    Uso:      lexer_incremental [arquivo] [edicoes] [semente]
+*/
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <random>
+#include "lexer_incremental.h"
+#include "programas.h"
+
+using namespace std;
+using namespace std::chrono;
+
+// Reconhece a fonte inteira, como o lexer sequencial
+FluxoTokens lexarTudo(const Fonte &fonte, TabelaSimbolos &simbolos)
+{
+    Lexer lexer(fonte, simbolos);
+    FluxoTokens tokens;
+    tokens.reservar(fonte.bytes() / 4 + 1);
+    for (Token tk = lexer.proximo(); tk.tipo != EOF; tk = lexer.proximo())
+        tokens.adicionar(tk);
+    return tokens;
+}
+
+// Os ids dos símbolos dependem da ordem em que foram internados, então os
+// identificadores são comparados pelo nome
+bool iguais(const FluxoTokens &a, const TabelaSimbolos &simbolosA, const FluxoTokens &b, const TabelaSimbolos &simbolosB)
+{
+    if (a.tipos != b.tipos || a.inicios != b.inicios || a.tamanhos != b.tamanhos)
+        return false;
+
+    for (size_t i = 0; i < a.tamanho(); i++)
+    {
+        if ((a.simbolos[i] < 0) != (b.simbolos[i] < 0))
+            return false;
+        if (a.simbolos[i] >= 0 && simbolosA.nome(a.simbolos[i]) != simbolosB.nome(b.simbolos[i]))
+            return false;
+    }
+
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    const int EDICOES = argc > 2 ? atoi(argv[2]) : 1000;
+    mt19937 aleatorio(argc > 3 ? atoi(argv[3]) : 1);
+
+    Fonte fonte;
+    if (argc > 1)
+    {
+        if (!fonte.abrir(argv[1]))
+        {
+            cerr << "Deu pra abrir não" << endl;
+            return 1;
+        }
+    }
+    else
+    {
+        ParametrosPrograma parametros;
+        parametros.bytes = 1 << 20;
+        fonte.carregarTexto(gerarPrograma(MISTO, parametros));
+    }
+
+    const char *const pedacos[] = {"", "a", "x1", " ", "\n", "\t", "\"", "\"texto\"", "42", "3.", ".5", "+", "=", "+=",
+                                   "<=", ";", "(", ")", "sepe", "fimpim", "\xc3\xa9", "\xe2\x82\xac", "\xf0\x9f\x98\x80",
+                                   "\xc3", "\x80", "\xff", "\xed\xa0\x80"};
+    const int numPedacos = sizeof(pedacos) / sizeof(pedacos[0]);
+
+    TabelaSimbolos simbolos;
+    FluxoTokens tokens = lexarTudo(fonte, simbolos);
+
+    double tempoIncremental = 0, tempoCompleto = 0;
+    size_t relexados = 0;
+    int diferentes = 0;
+
+    for (int e = 0; e < EDICOES; e++)
+    {
+        // Às vezes perto do fim, onde o alcance do lexer é cortado pela fonte
+        const uint32_t tamanho = fonte.bytes();
+        const uint32_t inicio = e % 10 == 0 ? tamanho - min<uint32_t>(tamanho, aleatorio() % 8) : aleatorio() % (tamanho + 1);
+        const uint32_t removidos = min<uint32_t>(aleatorio() % 8, tamanho - inicio);
+
+        string inseridos;
+        for (int n = aleatorio() % 4; n > 0; n--)
+            inseridos += pedacos[aleatorio() % numPedacos];
+
+        fonte.substituir(inicio, removidos, inseridos);
+
+        auto start = high_resolution_clock::now();
+        const TrechoRelexado trecho = relexar(fonte, tokens, simbolos, {inicio, removidos, inseridos});
+        duration<double, milli> tempo = high_resolution_clock::now() - start;
+        tempoIncremental += tempo.count();
+        relexados += trecho.inseridos;
+
+        // Referência: a fonte editada reconhecida do começo
+        start = high_resolution_clock::now();
+        TabelaSimbolos simbolosReferencia;
+        const FluxoTokens referencia = lexarTudo(fonte, simbolosReferencia);
+        tempo = high_resolution_clock::now() - start;
+        tempoCompleto += tempo.count();
+
+        if (!iguais(tokens, simbolos, referencia, simbolosReferencia))
+        {
+            // Segue a partir da referência, para que um erro não contamine as edições seguintes
+            diferentes++;
+            simbolos = move(simbolosReferencia);
+            tokens = lexarTudo(fonte, simbolos);
+        }
+    }
+
+    cout << fixed << setprecision(4);
+    cout << "Fonte: " << fonte.bytes() << " bytes, " << tokens.tamanho() << " tokens, " << EDICOES << " edições" << endl;
+    cout << "incremental: " << tempoIncremental / EDICOES << " ms por edição, "
+         << double(relexados) / EDICOES << " tokens relexados por edição" << endl;
+    cout << "completo:    " << tempoCompleto / EDICOES << " ms por edição, speedup " << tempoCompleto / tempoIncremental << endl;
+
+    if (diferentes > 0)
+    {
+        cout << diferentes << " edições com tokens DIFERENTES DO LEXER COMPLETO!" << endl;
+        return 1;
+    }
+
+    cout << "Todos os resultados iguais aos do lexer completo" << endl;
+    return 0;
+}
@@ -0,0 +1,92 @@
+/*
+    Benchmark de escalabilidade do lexer paralelo.
+    Reconhece o mesmo arquivo com 1..N threads e compara com o lexer sequencial.
+
+    Compilar: g++ -std=c++17 -O2 -pthread -I.. lexer_paralelo.cpp -o lexer_paralelo
+    Uso:      lexer_paralelo <arquivo> [maxThreads] [repeticoes]
+*/
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include "lexer_paralelo.h"
+
+using namespace std;
+using namespace std::chrono;
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2)
+    {
+        cerr << "Uso: " << argv[0] << " <arquivo> [maxThreads] [repeticoes]" << endl;
+        return 1;
+    }
+
+    const int maxThreads = argc > 2 ? atoi(argv[2]) : max(1u, thread::hardware_concurrency());
+    const int ITER = argc > 3 ? atoi(argv[3]) : 5;
+
+    Fonte fonte;
+    if (!fonte.abrir(argv[1]))
+    {
+        cerr << "Deu pra abrir não" << endl;
+        return 1;
+    }
+
+    const double megabytes = fonte.bytes() / (1024.0 * 1024.0);
+
+    // Referência: lexer sequencial
+    FluxoTokens referencia;
+    TabelaSimbolos simbolosReferencia;
+    double tempoSequencial = 1e30;
+
+    for (int i = 0; i < ITER; i++)
+    {
+        auto start = high_resolution_clock::now();
+
+        TabelaSimbolos simbolos;
+        Lexer lexer(fonte, simbolos);
+        FluxoTokens tokens;
+        tokens.reservar(fonte.bytes() / 4 + 1);
+        for (Token tk = lexer.proximo(); tk.tipo != EOF; tk = lexer.proximo())
+            tokens.adicionar(tk);
+
+        duration<double, milli> tempo = high_resolution_clock::now() - start;
+        tempoSequencial = min(tempoSequencial, tempo.count());
+
+        referencia = move(tokens);
+        simbolosReferencia = move(simbolos);
+    }
+
+    cout << fixed << setprecision(2);
+    cout << "Arquivo: " << argv[1] << " (" << megabytes << " MB, " << referencia.tamanho() << " tokens, "
+         << referencia.bytesPorToken() << " bytes/token)" << endl;
+    cout << "sequencial: " << tempoSequencial << " ms, " << megabytes / (tempoSequencial / 1000.0) << " MB/s" << endl;
+
+    for (int n = 1; n <= maxThreads; n++)
+    {
+        PoolThreads pool(n);
+        double melhor = 1e30;
+        bool identico = true;
+
+        for (int i = 0; i < ITER; i++)
+        {
+            auto start = high_resolution_clock::now();
+
+            TabelaSimbolos simbolos;
+            FluxoTokens tokens = lexarParalelo(fonte, simbolos, pool);
+
+            duration<double, milli> tempo = high_resolution_clock::now() - start;
+            melhor = min(melhor, tempo.count());
+
+            identico = identico && tokens.tipos == referencia.tipos && tokens.inicios == referencia.inicios &&
+                       tokens.tamanhos == referencia.tamanhos && tokens.simbolos == referencia.simbolos &&
+                       simbolos.tamanho() == simbolosReferencia.tamanho();
+        }
+
+        cout << setw(3) << n << " threads: " << melhor << " ms, "
+             << megabytes / (melhor / 1000.0) << " MB/s, speedup " << tempoSequencial / melhor
+             << (identico ? "" : "  (DIFERENTE DO SEQUENCIAL!)") << endl;
+    }
+
+    return 0;
+}
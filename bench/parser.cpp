@@ -0,0 +1,205 @@
+/*
+    Benchmark do driver LR: tokens por segundo do PARSE numa entrada grande,
+    comparado com o lexer sozinho e com o driver antigo, que usava
+    std::stack, e com o PARSE montando a árvore sintática. Também conta as
+    alocações feitas durante as medições: com a pilha e a arena da árvore
+    já reservadas e os identificadores já internados, o PARSE não deve
+    alocar nada. Usa as tabelas de tabelas_cepe.h.
+
+    Compilar: make bench/parser
+    Uso:      parser [arquivo | --blocos N] [repeticoes]
+*/
+
+// Este benchmark conta as próprias alocações e mede sem a instrumentação
+#undef CEPE_INSTRUMENTACAO
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <stack>
+#include <cstdlib>
+#include <new>
+#include "lexer.h"
+#include "parser_lr.h"
+#include "ast.h"
+#include "programas.h"
+
+using namespace std;
+using namespace std::chrono;
+
+// Toda alocação do programa passa por aqui e é contada
+size_t alocacoes = 0;
+
+void *operator new(size_t n)
+{
+    alocacoes++;
+    if (void *p = malloc(n ? n : 1))
+        return p;
+    throw bad_alloc();
+}
+
+void operator delete(void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+
+// O driver de antes, com uma std::stack de estados e outra de símbolos,
+// só para comparação
+template <typename Tabelas>
+bool parseComStack(Lexer &lexer)
+{
+    stack<int> estados;
+    stack<int> simbolos;
+
+    estados.push(0);
+    simbolos.push(Tabelas::ladoEsquerdo(0));
+
+    while (true)
+    {
+        const int tokenAtual = lexer.espiar().tipo;
+        const int32_t acao = Tabelas::acao(estados.top(), tokenAtual);
+
+        switch (tipoAcao(acao))
+        {
+        case ERRO:
+            return false;
+
+        case ACEITAR:
+            return true;
+
+        case SHIFT:
+            estados.push(alvoAcao(acao));
+            simbolos.push(tokenAtual);
+            lexer.proximo();
+            break;
+
+        case REDUCE:
+        {
+            const int simboloReduce = Tabelas::ladoEsquerdo(alvoAcao(acao));
+            const int tamanhoReduce = Tabelas::tamanhoCorpo(alvoAcao(acao));
+
+            for (int i = 0; i < tamanhoReduce; i++)
+            {
+                simbolos.pop();
+                estados.pop();
+            }
+
+            estados.push(Tabelas::desvio(estados.top(), simboloReduce));
+            simbolos.push(simboloReduce);
+            break;
+        }
+        }
+    }
+}
+
+struct Medicao
+{
+    double ms = 1e30; // Melhor tempo
+    size_t alocacoes = 0;
+};
+
+// Roda f repeticoes vezes (depois de uma de aquecimento) e guarda o melhor tempo
+template <typename F>
+Medicao medir(int repeticoes, F f)
+{
+    f();
+
+    Medicao m;
+    const size_t antes = alocacoes;
+
+    for (int i = 0; i < repeticoes; i++)
+    {
+        auto start = high_resolution_clock::now();
+        f();
+        duration<double, milli> tempo = high_resolution_clock::now() - start;
+        m.ms = min(m.ms, tempo.count());
+    }
+
+    m.alocacoes = (alocacoes - antes) / repeticoes;
+    return m;
+}
+
+int main(int argc, char *argv[])
+{
+    Fonte fonte;
+    int repeticoes = 5;
+    int argumento = 1;
+
+    if (argc > 2 && strcmp(argv[1], "--blocos") == 0)
+    {
+        fonte.carregarTexto(gerarPrograma(atoi(argv[2])));
+        argumento = 3;
+    }
+    else if (argc > 1)
+    {
+        if (!fonte.abrir(argv[1]))
+        {
+            cerr << "Deu pra abrir não" << endl;
+            return 1;
+        }
+        argumento = 2;
+    }
+    else
+        fonte.carregarTexto(gerarPrograma(20000));
+
+    if (argc > argumento)
+        repeticoes = max(1, atoi(argv[argumento]));
+
+    // A mesma tabela de símbolos em todas as medições: depois do aquecimento
+    // todos os identificadores já estão nela
+    TabelaSimbolos simbolos;
+    PilhaLR pilha;
+    ArvoreAST arvore;
+    ConstrutorAST construtor(arvore);
+    size_t numTokens = 0;
+    bool aceita = true;
+
+    const Medicao lexer = medir(repeticoes, [&]()
+                                {
+                                    Lexer lexer(fonte, simbolos);
+                                    numTokens = 0;
+                                    for (Token tk = lexer.proximo(); tk.tipo != EOF; tk = lexer.proximo())
+                                        numTokens++; });
+
+    const Medicao novo = medir(repeticoes, [&]()
+                               {
+                                   Lexer lexer(fonte, simbolos);
+                                   Token erro;
+                                   aceita &= PARSE<TabelasCompiladas>(lexer, pilha, erro); });
+
+    const Medicao comArvore = medir(repeticoes, [&]()
+                                    {
+                                        Lexer lexer(fonte, simbolos);
+                                        Token erro;
+                                        aceita &= PARSE<TabelasCompiladas>(lexer, pilha, erro, construtor); });
+
+    const Medicao antigo = medir(repeticoes, [&]()
+                                 {
+                                     Lexer lexer(fonte, simbolos);
+                                     aceita &= parseComStack<TabelasCompiladas>(lexer); });
+
+    if (!aceita)
+    {
+        cerr << "A entrada tem erro de sintaxe." << endl;
+        return 1;
+    }
+
+    auto tokensPorSegundo = [&](const Medicao &m)
+    { return numTokens / (m.ms / 1000.0) / 1e6; };
+
+    cout << fixed << setprecision(2)
+         << "Entrada: " << fonte.bytes() / (1024.0 * 1024.0) << " MB, " << numTokens << " tokens, "
+         << arvore.nos.size() << " nós na árvore (" << (arvore.nos.size() * sizeof(NoAST) + arvore.filhos.size() * sizeof(uint32_t)) / (1024.0 * 1024.0) << " MB)" << endl
+         << endl
+         << setw(22) << left << "" << setw(12) << right << "ms" << setw(14) << "Mtokens/s" << setw(16) << "alocações" << endl;
+
+    auto linha = [&](const char *nome, const Medicao &m)
+    {
+        cout << setw(22) << left << nome << setw(12) << right << m.ms << setw(14) << tokensPorSegundo(m) << setw(14) << m.alocacoes << endl;
+    };
+
+    linha("lexer sozinho", lexer);
+    linha("lexer + PARSE", novo);
+    linha("lexer + PARSE + AST", comArvore);
+    linha("lexer + std::stack", antigo);
+
+    return 0;
+}
@@ -0,0 +1,253 @@
+/*
+    Gerador de programas CePe sintéticos para os benchmarks. Cada forma
+    exercita uma parte diferente do lexer e do parser:
+
+        misto      blocos parecidos com código de verdade
+        aninhado   paparapa/dupuranpantepe/sepe uns dentro dos outros (pilha funda)
+        expressao  expressões compridas, com parênteses, chamadas e índices
+        literais   muitas declarações lispistapa com listas literais
+
+    Os programas são repetidos até passarem de um tamanho em bytes e são
+    sempre os mesmos para os mesmos parâmetros, para que as medições de
+    execuções diferentes sejam comparáveis
+*/
+
+#ifndef CEPE_BENCH_PROGRAMAS_H
+#define CEPE_BENCH_PROGRAMAS_H
+
+#include <string>
+
+using namespace std;
+
+enum FormaPrograma
+{
+    MISTO,
+    ANINHADO,
+    EXPRESSAO,
+    LITERAIS,
+};
+
+const char *const NOMES_FORMAS[] = {"misto", "aninhado", "expressao", "literais"};
+
+struct ParametrosPrograma
+{
+    size_t bytes = 8 << 20;  // Tamanho mínimo do programa
+    int profundidade = 64;   // Blocos uns dentro dos outros, em ANINHADO
+    int termos = 256;        // Termos de cada expressão, em EXPRESSAO
+    int itens = 16;          // Itens de cada lista, em LITERAIS
+};
+
+// Um bloco de MISTO, variando os nomes para que a tabela de símbolos tenha
+// algumas centenas de identificadores
+inline void blocoMisto(string &programa, int k)
+{
+    const string v = to_string(k % 256);
+
+    programa += "inpintepe total" + v + " = (a" + v + " + b) * 3 - c / 2;\n"
+                "lispistapa lista" + v + " = [1, 2, 3, total" + v + "];\n"
+                "paparapa (inpintepe i = 0; i < 10; i += 1)\n"
+                "    lista" + v + "[i] = f(i, [1, 2.5, -i]) + 2.5;\n"
+                "    sepe i > 3 epe naopao pronto" + v + " enpentaopao\n"
+                "        total" + v + " += i;\n"
+                "    sepenaopao\n"
+                "        total" + v + " -= 1;\n"
+                "    fimpim\n"
+                "fimpim\n"
+                "dupuranpantepe total" + v + " >= 0 oupou fapalapacipiapa\n"
+                "    total" + v + " = total" + v + " - 1;\n"
+                "    imprimir(\"volta\", total" + v + ");\n"
+                "fimpim\n";
+}
+
+// profundidade blocos, alternando os três tipos, com um comando em cada nível
+inline void blocoAninhado(string &programa, int k, int profundidade)
+{
+    const string v = to_string(k % 64);
+
+    for (int nivel = 0; nivel < profundidade; nivel++)
+    {
+        const string n = to_string(nivel);
+
+        switch (nivel % 3)
+        {
+        case 0:
+            programa += "paparapa (inpintepe i" + n + " = 0; i" + n + " < " + v + "; i" + n + " += 1)\n";
+            break;
+        case 1:
+            programa += "dupuranpantepe x" + v + " > " + n + "\n";
+            break;
+        default:
+            programa += "sepe x" + v + " ipigualpal " + n + " enpentaopao\n";
+            break;
+        }
+
+        programa += "x" + v + " += " + n + ";\n";
+    }
+
+    for (int nivel = profundidade - 1; nivel >= 0; nivel--)
+    {
+        if (nivel % 3 == 2)
+            programa += "sepenaopao\nx" + v + " -= 1;\n";
+        programa += "fimpim\n";
+    }
+}
+
+// Uma atribuição com termos termos, misturando os operadores e abrindo um
+// parêntese a cada poucos termos
+inline void blocoExpressao(string &programa, int k, int termos)
+{
+    const char *const operadores[] = {" + ", " - ", " * ", " / "};
+    int abertos = 0;
+
+    programa += "r" + to_string(k % 128) + " = ";
+
+    for (int t = 0; t < termos; t++)
+    {
+        if (t > 0)
+            programa += operadores[(k + t) % 4];
+
+        if (t % 7 == 3 && t + 1 < termos)
+        {
+            programa += "(";
+            abertos++;
+        }
+
+        switch (t % 5)
+        {
+        case 0:
+            programa += "a" + to_string(t % 32);
+            break;
+        case 1:
+            programa += to_string(t);
+            break;
+        case 2:
+            programa += "f(b, " + to_string(t) + ".5)";
+            break;
+        case 3:
+            programa += "v[i + " + to_string(t % 10) + "]";
+            break;
+        default:
+            programa += "-c";
+            break;
+        }
+
+        if (t % 7 == 5 && abertos > 0)
+        {
+            programa += ")";
+            abertos--;
+        }
+    }
+
+    programa += string(abertos, ')') + ";\n";
+}
+
+// Uma declaração lispistapa com uma lista literal de itens itens
+inline void blocoLiterais(string &programa, int k, int itens)
+{
+    programa += "lispistapa l" + to_string(k % 512) + " = [";
+
+    for (int i = 0; i < itens; i++)
+    {
+        if (i > 0)
+            programa += ", ";
+
+        switch (i % 6)
+        {
+        case 0:
+            programa += to_string(k + i);
+            break;
+        case 1:
+            programa += to_string(i) + ".25";
+            break;
+        case 2:
+            programa += "\"item" + to_string(i) + "\"";
+            break;
+        case 3:
+            programa += "[" + to_string(i) + ", x]";
+            break;
+        case 4:
+            programa += "verperdapadepe";
+            break;
+        default:
+            programa += "-y";
+            break;
+        }
+    }
+
+    programa += "];\n";
+}
+
+inline string gerarPrograma(FormaPrograma forma, const ParametrosPrograma &p)
+{
+    string programa;
+    programa.reserve(p.bytes + 4096);
+
+    for (int k = 0; programa.size() < p.bytes; k++)
+    {
+        switch (forma)
+        {
+        case MISTO:
+            blocoMisto(programa, k);
+            break;
+        case ANINHADO:
+            blocoAninhado(programa, k, p.profundidade);
+            break;
+        case EXPRESSAO:
+            blocoExpressao(programa, k, p.termos);
+            break;
+        case LITERAIS:
+            blocoLiterais(programa, k, p.itens);
+            break;
+        }
+    }
+
+    return programa;
+}
+
+// n blocos de MISTO
+inline string gerarPrograma(int n)
+{
+    string programa;
+
+    for (int k = 0; k < n; k++)
+        blocoMisto(programa, k);
+
+    return programa;
+}
+
+/*
+    Gramática sintética com niveis níveis de blocos: os comandos de cada
+    nível são atribuições ou sepe/dupuranpantepe cujos corpos são comandos
+    do nível seguinte, e todos usam as mesmas expressões. Cada nível tem os
+    seus não terminais, então o número de estados cresce com niveis e a
+    gramática continua sem conflitos
+*/
+inline string gerarGramatica(int niveis)
+{
+    string bnf = "programa : lista0 ;\n";
+
+    for (int nivel = 0; nivel < niveis; nivel++)
+    {
+        const string n = to_string(nivel), proximo = "lista" + to_string(nivel + 1);
+
+        bnf += "lista" + n + " : lista" + n + " comando" + n + " | ;\n"
+               "comando" + n + " : ID '=' expr ';'";
+
+        if (nivel + 1 < niveis)
+            bnf += "\n    | 'sepe' expr 'enpentaopao' " + proximo + " 'fimpim'"
+                   "\n    | 'dupuranpantepe' expr " + proximo + " 'fimpim'";
+
+        bnf += " ;\n";
+    }
+
+    bnf += "expr : expr 'oupou' conjuncao | conjuncao ;\n"
+           "conjuncao : conjuncao 'epe' comparacao | comparacao ;\n"
+           "comparacao : soma '<' soma | soma ;\n"
+           "soma : soma '+' termo | soma '-' termo | termo ;\n"
+           "termo : termo '*' fator | fator ;\n"
+           "fator : ID | INT_NUM | '(' expr ')' | '-' fator ;\n";
+
+    return bnf;
+}
+
+#endif
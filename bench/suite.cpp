@@ -0,0 +1,272 @@
+/*
+    Suíte de benchmarks do CePe, com a saída em JSON para acompanhar
+    regressões de uma versão para a outra. As chaves saem sempre na mesma
+    ordem e os números com a mesma precisão, então duas saídas podem ser
+    comparadas direto.
+
+    Para cada forma de programa sintético (veja programas.h): MB/s do lexer
+    sozinho e milhões de tokens por segundo do lexer + PARSE, com e sem a
+    árvore sintática, usando as tabelas de tabelas_cepe.h. Para gramatica.bnf
+    e para gramáticas sintéticas de vários tamanhos: tempo de geração das
+    tabelas LR(1) e LALR(1) e quantos estados cada uma teve. No fim, o pico
+    de memória do processo.
+
+    O gerador de tabelas é o de parser.cpp, incluído aqui sem o main.
+
+    Compilar: make bench/suite
+    Uso:      suite [--mb N] [--profundidade D] [--termos T] [--itens I]
+                    [--niveis 4,16,64] [--gramatica arquivo] [--threads N]
+                    [--repeticoes R]
+*/
+
+#define CEPE_SEM_MAIN
+#include "../parser.cpp" // Não o bench/parser.cpp
+#include "programas.h"
+
+#include <iomanip>
+#include <filesystem>
+#include <sstream>
+#include <sys/resource.h>
+
+struct Parametros
+{
+    ParametrosPrograma programa;
+    vector<int> niveis = {4, 16, 64};
+    const char *gramatica = GRAMATICA_PADRAO;
+    int threads = 1;
+    int repeticoes = 5;
+};
+
+struct ResultadoPrograma
+{
+    FormaPrograma forma;
+    size_t bytes;
+    size_t tokens;
+    double lexerMs;
+    double parseMs;
+    double arvoreMs;
+};
+
+struct ResultadoGramatica
+{
+    string nome;
+    int regras;
+    int terminais;
+    int naoTerminais;
+    int estadosLR1;
+    int estadosLALR;
+    int conflitos;
+    double lr1Ms;
+    double lalrMs;
+};
+
+// Roda f repeticoes vezes (depois de uma de aquecimento) e retorna o melhor tempo, em ms
+template <typename F>
+double melhorTempo(int repeticoes, F f)
+{
+    f();
+
+    double melhor = 1e30;
+    for (int i = 0; i < repeticoes; i++)
+    {
+        auto start = high_resolution_clock::now();
+        f();
+        duration<double, milli> tempo = high_resolution_clock::now() - start;
+        melhor = min(melhor, tempo.count());
+    }
+
+    return melhor;
+}
+
+bool medirPrograma(FormaPrograma forma, const Parametros &p, ResultadoPrograma &r)
+{
+    Fonte fonte;
+    fonte.carregarTexto(gerarPrograma(forma, p.programa));
+
+    TabelaSimbolos simbolos;
+    PilhaLR pilha;
+    ArvoreAST arvore;
+    ConstrutorAST construtor(arvore);
+    bool aceita = true;
+
+    r = {forma, fonte.bytes(), 0, 0, 0, 0};
+
+    r.lexerMs = melhorTempo(p.repeticoes, [&]()
+                            {
+                                Lexer lexer(fonte, simbolos);
+                                r.tokens = 0;
+                                for (Token tk = lexer.proximo(); tk.tipo != EOF; tk = lexer.proximo())
+                                    r.tokens++; });
+
+    r.parseMs = melhorTempo(p.repeticoes, [&]()
+                            {
+                                Lexer lexer(fonte, simbolos);
+                                Token erro;
+                                aceita &= PARSE<TabelasCompiladas>(lexer, pilha, erro); });
+
+    r.arvoreMs = melhorTempo(p.repeticoes, [&]()
+                             {
+                                 Lexer lexer(fonte, simbolos);
+                                 Token erro;
+                                 aceita &= PARSE<TabelasCompiladas>(lexer, pilha, erro, construtor); });
+
+    if (!aceita)
+        cerr << "O programa " << NOMES_FORMAS[forma] << " gerado tem erro de sintaxe." << endl;
+
+    return aceita;
+}
+
+bool medirGramatica(const string &nome, const char *caminho, const Parametros &p, ResultadoGramatica &r)
+{
+    if (!lerGramatica(caminho))
+        return false;
+
+    threadsGeracao = p.threads;
+    r.nome = nome;
+    r.regras = tamanhoGramatica;
+    r.terminais = numTerminais;
+    r.naoTerminais = numNaoTerminais;
+
+    r.lr1Ms = melhorTempo(p.repeticoes, [&]()
+                          { r.estadosLR1 = gerarTabelas(false); });
+    r.conflitos = conflitos.size();
+
+    r.lalrMs = melhorTempo(p.repeticoes, [&]()
+                           { gerarTabelas(true); });
+    r.estadosLALR = estados.size();
+
+    return true;
+}
+
+string textoJSON(const string &texto)
+{
+    string json = "\"";
+
+    for (char c : texto)
+    {
+        if (c == '"' || c == '\\')
+            json += '\\';
+        if ((unsigned char)c >= 0x20)
+            json += c;
+    }
+
+    return json + "\"";
+}
+
+int main(int argc, char *argv[])
+{
+    Parametros p;
+
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        const string opcao = argv[i];
+        const char *valor = argv[i + 1];
+
+        if (opcao == "--mb")
+            p.programa.bytes = size_t(atof(valor) * (1 << 20));
+        else if (opcao == "--profundidade")
+            p.programa.profundidade = max(1, atoi(valor));
+        else if (opcao == "--termos")
+            p.programa.termos = max(1, atoi(valor));
+        else if (opcao == "--itens")
+            p.programa.itens = max(1, atoi(valor));
+        else if (opcao == "--gramatica")
+            p.gramatica = valor;
+        else if (opcao == "--threads")
+            p.threads = max(1, atoi(valor));
+        else if (opcao == "--repeticoes")
+            p.repeticoes = max(1, atoi(valor));
+        else if (opcao == "--niveis")
+        {
+            p.niveis.clear();
+            stringstream lista(valor);
+            for (string n; getline(lista, n, ',');)
+                p.niveis.push_back(max(1, atoi(n.c_str())));
+        }
+        else
+        {
+            cerr << "Opção desconhecida " << opcao << endl;
+            return 1;
+        }
+    }
+
+    if (argc % 2 == 0)
+    {
+        cerr << "Uso: " << argv[0] << " [--mb N] [--profundidade D] [--termos T] [--itens I] [--niveis 4,16,64] "
+                                      "[--gramatica arquivo] [--threads N] [--repeticoes R]"
+             << endl;
+        return 1;
+    }
+
+    vector<ResultadoPrograma> programas;
+    for (FormaPrograma forma : {MISTO, ANINHADO, EXPRESSAO, LITERAIS})
+    {
+        programas.emplace_back();
+        if (!medirPrograma(forma, p, programas.back()))
+            return 1;
+    }
+
+    // A gramática do CePe e as sintéticas, que são gravadas num arquivo temporário
+    vector<ResultadoGramatica> gramaticas;
+    ResultadoGramatica r;
+
+    if (medirGramatica("cepe", p.gramatica, p, r))
+        gramaticas.push_back(r);
+
+    const string temporario = (filesystem::temp_directory_path() / "cepe_suite.bnf").string();
+
+    for (int niveis : p.niveis)
+    {
+        ofstream(temporario) << gerarGramatica(niveis);
+        if (!medirGramatica("sintetica" + to_string(niveis), temporario.c_str(), p, r))
+            return 1;
+        gramaticas.push_back(r);
+    }
+
+    filesystem::remove(temporario);
+
+    rusage uso;
+    getrusage(RUSAGE_SELF, &uso);
+
+    auto porSegundo = [](double quantidade, double ms)
+    { return quantidade / (ms / 1000.0); };
+
+    cout << fixed << setprecision(3)
+         << "{\n"
+         << "  \"parametros\": {\"bytes\": " << p.programa.bytes << ", \"profundidade\": " << p.programa.profundidade
+         << ", \"termos\": " << p.programa.termos << ", \"itens\": " << p.programa.itens
+         << ", \"threads\": " << p.threads << ", \"repeticoes\": " << p.repeticoes << "},\n"
+         << "  \"programas\": [\n";
+
+    for (size_t i = 0; i < programas.size(); i++)
+    {
+        const ResultadoPrograma &pr = programas[i];
+
+        cout << "    {\"forma\": " << textoJSON(NOMES_FORMAS[pr.forma]) << ", \"bytes\": " << pr.bytes << ", \"tokens\": " << pr.tokens
+             << ", \"lexer_mb_s\": " << porSegundo(pr.bytes / (1024.0 * 1024.0), pr.lexerMs)
+             << ", \"parser_mtokens_s\": " << porSegundo(pr.tokens / 1e6, pr.parseMs)
+             << ", \"ast_mtokens_s\": " << porSegundo(pr.tokens / 1e6, pr.arvoreMs) << "}"
+             << (i + 1 < programas.size() ? "," : "") << "\n";
+    }
+
+    cout << "  ],\n"
+         << "  \"gramaticas\": [\n";
+
+    for (size_t i = 0; i < gramaticas.size(); i++)
+    {
+        const ResultadoGramatica &g = gramaticas[i];
+
+        cout << "    {\"nome\": " << textoJSON(g.nome) << ", \"regras\": " << g.regras << ", \"terminais\": " << g.terminais
+             << ", \"nao_terminais\": " << g.naoTerminais << ", \"estados_lr1\": " << g.estadosLR1
+             << ", \"estados_lalr\": " << g.estadosLALR << ", \"conflitos_lr1\": " << g.conflitos
+             << ", \"geracao_lr1_ms\": " << g.lr1Ms << ", \"geracao_lalr_ms\": " << g.lalrMs << "}"
+             << (i + 1 < gramaticas.size() ? "," : "") << "\n";
+    }
+
+    // ru_maxrss vem em KB no Linux
+    cout << "  ],\n"
+         << "  \"pico_rss_kb\": " << uso.ru_maxrss << "\n"
+         << "}" << endl;
+
+    return 0;
+}
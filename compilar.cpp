@@ -0,0 +1,195 @@
+/*
+    Compilação em lote: reconhece muitos arquivos CePe de uma vez, em
+    paralelo, e monta a árvore sintática de cada um.
+
+    As tabelas do parser são as de tabelas_cepe.h, imutáveis e
+    compartilhadas por todas as threads. Cada thread tem a sua fonte, a sua
+    pilha, a sua arena de árvore e a sua tabela de símbolos, reaproveitadas
+    de um arquivo para o outro. Os arquivos são distribuídos com roubo de
+    trabalho, e um erro de sintaxe num arquivo é anotado sem parar o lote.
+
+    Uso: compilar [-j threads] <arquivo ou diretório>...
+    Diretórios são percorridos recursivamente atrás de arquivos .cepe
+*/
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <filesystem>
+#include <memory>
+#include <cstring>
+#include "lexer.h"
+#include "parser_lr.h"
+#include "ast.h"
+#include "threads.h"
+
+using namespace std;
+using namespace std::chrono;
+
+const char *const EXTENSAO_CEPE = ".cepe";
+
+struct ResultadoArquivo
+{
+    bool aceito = false;
+    string erro; // Onde e por que o arquivo não foi aceito
+    size_t bytes = 0;
+    size_t tokens = 0;
+    size_t nos = 0;
+};
+
+// Monta a árvore e conta os tokens lidos
+struct AcoesLote : ConstrutorAST
+{
+    using ConstrutorAST::ConstrutorAST;
+
+    size_t tokens = 0;
+
+    void comecar()
+    {
+        tokens = 0;
+        ConstrutorAST::comecar();
+    }
+
+    void shift(const Token &tk)
+    {
+        tokens++;
+        ConstrutorAST::shift(tk);
+    }
+};
+
+// Estruturas de cada thread, reaproveitadas de um arquivo para o outro
+struct alignas(64) EstadoThread
+{
+    Fonte fonte;
+    TabelaSimbolos simbolos;
+    PilhaLR pilha;
+    ArvoreAST arvore;
+    AcoesLote acoes{arvore};
+};
+
+// Acrescenta o arquivo, ou os arquivos .cepe do diretório e subdiretórios
+bool coletarArquivos(const char *caminho, vector<string> &arquivos)
+{
+    error_code ec;
+
+    if (!filesystem::is_directory(caminho, ec))
+    {
+        if (!filesystem::exists(caminho, ec))
+            return false;
+
+        arquivos.push_back(caminho);
+        return true;
+    }
+
+    for (filesystem::recursive_directory_iterator it(caminho, filesystem::directory_options::skip_permission_denied, ec), fim;
+         !ec && it != fim; it.increment(ec))
+    {
+        if (it->is_regular_file(ec) && it->path().extension() == EXTENSAO_CEPE)
+            arquivos.push_back(it->path().string());
+    }
+
+    return !ec;
+}
+
+ResultadoArquivo compilarArquivo(const string &caminho, EstadoThread &estado)
+{
+    ResultadoArquivo resultado;
+
+    if (!estado.fonte.abrir(caminho))
+    {
+        resultado.erro = " não deu pra abrir";
+        return resultado;
+    }
+
+    estado.simbolos.limpar();
+    Lexer lexer(estado.fonte, estado.simbolos);
+
+#ifdef CEPE_INSTRUMENTACAO
+    // No parse o lexer só roda junto; aqui ele passa uma vez sozinho pelo
+    // arquivo para ter o seu tempo. Os ids dos símbolos não mudam, pois o
+    // parse interna os mesmos nomes na mesma ordem
+    {
+        CEPE_FASE(FASE_LEXER);
+        for (Lexer sozinho(estado.fonte, estado.simbolos); sozinho.proximo().tipo != EOF;)
+            CEPE_CONTAR(TOKENS);
+    }
+#endif
+    Token erro;
+
+    resultado.aceito = PARSE<TabelasCompiladas>(lexer, estado.pilha, erro, estado.acoes);
+    resultado.bytes = estado.fonte.bytes();
+    resultado.tokens = estado.acoes.tokens;
+    resultado.nos = estado.arvore.nos.size();
+
+    if (!resultado.aceito)
+    {
+        const LinhaColuna lc = estado.fonte.linhaColuna(erro.inicio);
+        resultado.erro = to_string(lc.linha) + ":" + to_string(lc.coluna) + ": erro de sintaxe " +
+                         (erro.tipo == EOF ? "no fim do arquivo" : "em '" + string(estado.fonte.lexema(erro)) + "'");
+    }
+
+    estado.fonte.fechar();
+    return resultado;
+}
+
+int main(int argc, char *argv[])
+{
+    int numThreads = thread::hardware_concurrency();
+    vector<string> arquivos;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-j") == 0 && i + 1 < argc)
+            numThreads = atoi(argv[++i]);
+        else if (!coletarArquivos(argv[i], arquivos))
+            cerr << argv[i] << ": não existe ou não deu pra ler." << endl;
+    }
+
+    if (arquivos.empty())
+    {
+        cerr << "Uso: " << argv[0] << " [-j threads] <arquivo ou diretório>..." << endl;
+        return 1;
+    }
+
+    // Em ordem, para que os erros saiam sempre na mesma ordem
+    sort(arquivos.begin(), arquivos.end());
+    arquivos.erase(unique(arquivos.begin(), arquivos.end()), arquivos.end());
+
+    auto start = high_resolution_clock::now();
+
+    PoolThreads pool(numThreads);
+    unique_ptr<EstadoThread[]> estados(new EstadoThread[pool.tamanho()]);
+    vector<ResultadoArquivo> resultados(arquivos.size());
+
+    pool.paraCadaRoubando(arquivos.size(), [&](int i, int thread)
+                          { resultados[i] = compilarArquivo(arquivos[i], estados[thread]); });
+
+    duration<double, milli> tempo = high_resolution_clock::now() - start;
+
+    size_t comErro = 0, bytes = 0, tokens = 0, nos = 0;
+    for (size_t i = 0; i < arquivos.size(); i++)
+    {
+        const ResultadoArquivo &r = resultados[i];
+
+        if (!r.aceito)
+        {
+            cerr << arquivos[i] << ":" << r.erro << endl;
+            comErro++;
+        }
+
+        bytes += r.bytes;
+        tokens += r.tokens;
+        nos += r.nos;
+    }
+
+    const double segundos = tempo.count() / 1000.0;
+
+    cout << fixed << setprecision(2)
+         << arquivos.size() << " arquivo(s), " << comErro << " com erro, " << tokens << " tokens, "
+         << nos << " nós, " << bytes / (1024.0 * 1024.0) << " MB em " << tempo.count() << " ms ("
+         << pool.tamanho() << " threads)" << endl
+         << arquivos.size() / segundos << " arquivos/s, " << tokens / segundos / 1e6 << " Mtokens/s, "
+         << bytes / (1024.0 * 1024.0) / segundos << " MB/s" << endl;
+
+    return comErro == 0 ? 0 : 1;
+}
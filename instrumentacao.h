@@ -0,0 +1,213 @@
+/*
+    Instrumentação opcional do compilador: quanto tempo cada fase levou e
+    contadores do que o gerador e o parser fizeram. Só existe compilando
+    com -DCEPE_INSTRUMENTACAO (make INSTRUMENTAR=1); sem a flag, as macros
+    abaixo somem junto com os seus argumentos e nada disso é compilado.
+
+    Cada thread acumula as suas medições num bloco próprio, sem trava nem
+    atômico no caminho quente, e os blocos são somados no fim. Os tempos
+    das fases são a soma das threads, e as fases são inclusivas: o parse
+    inclui o lexer que ele vai puxando, e o fechamento dos estados não
+    entra no goto. O lexer é medido uma vez por passada inteira, nunca
+    por token: no parser e no compilar ele passa uma vez a mais sozinho
+    pela fonte só para isso, e os tokens dessas passadas são contados.
+    Ao sair, tudo é gravado em JSON no arquivo indicado pela variável de
+    ambiente CEPE_MEDICOES, ou em stderr.
+
+    As alocações são contadas substituindo o operator new, então este
+    cabeçalho instrumentado só pode ser incluído por um arquivo .cpp do
+    programa (o que já vale para todos os programas do CePe)
+*/
+
+#ifndef CEPE_INSTRUMENTACAO_H
+#define CEPE_INSTRUMENTACAO_H
+
+enum Fase
+{
+    FASE_LEXER,
+    FASE_FIRST,
+    FASE_FOLLOW,
+    FASE_FECHAMENTO,
+    FASE_GOTO,
+    FASE_LALR,
+    FASE_EMISSAO,
+    FASE_PARSE,
+    NUM_FASES
+};
+
+enum Contador
+{
+    TOKENS,               // Reconhecidos nas passadas medidas do lexer
+    ITERACOES_FECHAMENTO, // Posições produzidas pelos fechamentos
+    PLANOS_FECHAMENTO,    // Planos feitos, os que não estavam no memo
+    POSICOES_CRIADAS,     // Posições guardadas nos estados
+    ESTADOS,              // Estados LR(1) criados
+    CONFLITOS,
+    SHIFTS,
+    REDUCES,
+    PROFUNDIDADE_PILHA, // Máximo, não soma
+    ALOCACOES,
+    NUM_CONTADORES
+};
+
+#ifdef CEPE_INSTRUMENTACAO
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <new>
+#include <vector>
+#include <algorithm>
+
+using namespace std;
+
+const char *const NOMES_FASES[NUM_FASES] = {"lexer", "first", "follow", "fechamento", "goto", "lalr", "emissao", "parse"};
+const char *const NOMES_CONTADORES[NUM_CONTADORES] = {"tokens", "iteracoes_fechamento", "planos_fechamento", "posicoes_criadas", "estados",
+                                                      "conflitos", "shifts", "reduces", "profundidade_pilha", "alocacoes"};
+
+// Fora dos blocos das threads: o operator new pode rodar antes de o bloco
+// da thread existir, inclusive para criá-lo
+inline atomic<uint64_t> alocacoesInstrumentadas{0};
+
+struct Medicoes
+{
+    uint64_t nanos[NUM_FASES] = {};
+    uint64_t vezes[NUM_FASES] = {};
+    uint64_t contadores[NUM_CONTADORES] = {};
+
+    void juntar(const Medicoes &outra)
+    {
+        for (int f = 0; f < NUM_FASES; f++)
+        {
+            nanos[f] += outra.nanos[f];
+            vezes[f] += outra.vezes[f];
+        }
+
+        for (int c = 0; c < NUM_CONTADORES; c++)
+            contadores[c] = c == PROFUNDIDADE_PILHA ? max(contadores[c], outra.contadores[c]) : contadores[c] + outra.contadores[c];
+    }
+};
+
+/*
+    Blocos de todas as threads. Uma thread que termina deixa as suas
+    medições em encerradas; o registro é destruído depois de todas (a
+    thread principal inclusive), e é aí que o JSON é gravado
+*/
+class RegistroMedicoes
+{
+public:
+    static RegistroMedicoes &global()
+    {
+        static RegistroMedicoes registro;
+        return registro;
+    }
+
+    void registrar(Medicoes *m)
+    {
+        lock_guard<mutex> trava(mtx);
+        vivas.push_back(m);
+    }
+
+    void encerrar(Medicoes *m)
+    {
+        lock_guard<mutex> trava(mtx);
+        encerradas.juntar(*m);
+        vivas.erase(find(vivas.begin(), vivas.end(), m));
+    }
+
+    ~RegistroMedicoes()
+    {
+        Medicoes total = encerradas;
+        for (Medicoes *m : vivas)
+            total.juntar(*m);
+        total.contadores[ALOCACOES] = alocacoesInstrumentadas;
+
+        const char *caminho = getenv("CEPE_MEDICOES");
+        FILE *saida = caminho != nullptr ? fopen(caminho, "w") : nullptr;
+        if (saida == nullptr)
+            saida = stderr;
+
+        fprintf(saida, "{\n  \"fases\": {");
+        for (int f = 0; f < NUM_FASES; f++)
+            fprintf(saida, "%s\n    \"%s\": {\"ms\": %.3f, \"vezes\": %llu}", f > 0 ? "," : "", NOMES_FASES[f],
+                    total.nanos[f] / 1e6, (unsigned long long)total.vezes[f]);
+
+        fprintf(saida, "\n  },\n  \"contadores\": {");
+        for (int c = 0; c < NUM_CONTADORES; c++)
+            fprintf(saida, "%s\n    \"%s\": %llu", c > 0 ? "," : "", NOMES_CONTADORES[c], (unsigned long long)total.contadores[c]);
+
+        fprintf(saida, "\n  }\n}\n");
+
+        if (saida != stderr)
+            fclose(saida);
+    }
+
+private:
+    mutex mtx;
+    vector<Medicoes *> vivas;
+    Medicoes encerradas;
+};
+
+struct MedicoesThread : Medicoes
+{
+    MedicoesThread() { RegistroMedicoes::global().registrar(this); }
+    ~MedicoesThread() { RegistroMedicoes::global().encerrar(this); }
+};
+
+inline Medicoes &medicoesDaThread()
+{
+    thread_local MedicoesThread medicoes;
+    return medicoes;
+}
+
+// Soma o tempo desde a criação até o fim do escopo na fase
+class MedidorFase
+{
+public:
+    explicit MedidorFase(Fase fase) : fase(fase), inicio(chrono::steady_clock::now()) {}
+
+    ~MedidorFase()
+    {
+        Medicoes &m = medicoesDaThread();
+        m.nanos[fase] += chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - inicio).count();
+        m.vezes[fase]++;
+    }
+
+private:
+    Fase fase;
+    chrono::steady_clock::time_point inicio;
+};
+
+void *operator new(size_t n)
+{
+    alocacoesInstrumentadas.fetch_add(1, memory_order_relaxed);
+    if (void *p = malloc(n ? n : 1))
+        return p;
+    throw bad_alloc();
+}
+
+void operator delete(void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+
+#define CEPE_JUNTAR_(a, b) a##b
+#define CEPE_JUNTAR(a, b) CEPE_JUNTAR_(a, b)
+
+// Mede o resto do escopo atual
+#define CEPE_FASE(fase) MedidorFase CEPE_JUNTAR(medidorFase, __LINE__)(fase)
+#define CEPE_SOMAR(contador, n) (medicoesDaThread().contadores[contador] += (n))
+#define CEPE_CONTAR(contador) CEPE_SOMAR(contador, 1)
+#define CEPE_MAXIMO(contador, n) (medicoesDaThread().contadores[contador] = max<uint64_t>(medicoesDaThread().contadores[contador], (n)))
+
+#else
+
+#define CEPE_FASE(fase) ((void)0)
+#define CEPE_SOMAR(contador, n) ((void)0)
+#define CEPE_CONTAR(contador) ((void)0)
+#define CEPE_MAXIMO(contador, n) ((void)0)
+
+#endif
+
+#endif
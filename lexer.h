@@ -0,0 +1,763 @@
+/*
+    Lexer da linguagem CePe: tabela de tokens, fonte mapeada em memória e
+    um lexer que entrega os tokens sob demanda (proximo/espiar), para que
+    o parser consuma a entrada sem materializar a sequência inteira
+*/
+
+#ifndef CEPE_LEXER_H
+#define CEPE_LEXER_H
+
+#include <fstream>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <cstdint>
+#include <type_traits>
+#include <string>
+#include <string_view>
+#include <cstring>
+#include <memory>
+#include <algorithm>
+#include <cstdio>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "varredura.h"
+#include "automato.h"
+
+using namespace std;
+
+/*
+    Tabela de tokens da linguagem: é a única fonte para o enum Tokens,
+    para nomesTokens e para as palavras-chave reconhecidas pelo lexer.
+    X(enumerador, nome, palavra-chave) — a palavra-chave fica vazia
+    para tokens que não vêm de uma palavra reservada
+*/
+#define TOKENS_CEPE(X)                       \
+    X(ID, "id", "")                          \
+    X(INT_NUM, "num int", "")                \
+    X(FLOAT_NUM, "num float", "")            \
+    X(STRING_LIT, "literal string", "")      \
+    X(TRUE_TK, "true", "verperdapadepe")     \
+    X(FALSE_TK, "false", "fapalapacipiapa")  \
+    X(INT_TK, "int", "inpintepe")            \
+    X(FLOAT_TK, "float", "virpirgupulapa")   \
+    X(CHAR_TK, "char", "simpim") /* SIMbolo */ \
+    X(STRING_TK, "string", "serperiepie")    \
+    X(LIST_TK, "list", "lispistapa")         \
+    X(BOOL_TK, "bool", "boopoo")             \
+    X(FUNCTION_TK, "function", "funpuncaopao") \
+    X(FOR_TK, "for", "paparapa")             \
+    X(WHILE_TK, "while", "dupuranpantepe")   \
+    X(IF_TK, "if", "sepe")                   \
+    X(THEN_TK, "then", "enpentaopao")        \
+    X(ELSE_TK, "else", "sepenaopao")         \
+    X(END_TK, "end", "fimpim")               \
+    X(EQ_TK, "==", "ipigualpal")             \
+    X(NOT_TK, "not", "naopao")               \
+    X(AND_TK, "and", "epe")                  \
+    X(OR_TK, "or", "oupou")                  \
+    X(MAIS_IGUAL, "+=", "")                  \
+    X(MENOS_IGUAL, "-=", "")                 \
+    X(VEZES_IGUAL, "*=", "")                 \
+    X(DIVIDIDO_IGUAL, "/=", "")              \
+    X(MAIOR_IGUAL, ">=", "")                 \
+    X(MENOR_IGUAL, "<=", "")
+
+/*
+    Grafias alternativas, com acentos, de palavras-chave que já estão em
+    TOKENS_CEPE. X(enumerador, palavra-chave)
+*/
+#define GRAFIAS_ACENTUADAS(X)          \
+    X(FUNCTION_TK, "funpunçãopão")     \
+    X(THEN_TK, "enpentãopão")          \
+    X(ELSE_TK, "sepenãopão")
+
+// Tipos de token na linguagem
+enum Tokens
+{
+    ANTES_DO_PRIMEIRO_TOKEN = 255, // Valores abaixo de 256 são os próprios caracteres
+#define X(tk, nome, palavra) tk,
+    TOKENS_CEPE(X)
+#undef X
+    FIM_TOKENS
+};
+
+inline map<int, string> nomesTokens = {
+#define X(tk, nome, palavra) {Tokens::tk, nome},
+    TOKENS_CEPE(X)
+#undef X
+};
+
+struct PalavraChave
+{
+    string_view palavra;
+    int tipo;
+};
+
+constexpr PalavraChave palavrasChave[] = {
+#define X(tk, nome, palavra) {palavra, Tokens::tk},
+    TOKENS_CEPE(X)
+#undef X
+#define X(tk, palavra) {palavra, Tokens::tk},
+    GRAFIAS_ACENTUADAS(X)
+#undef X
+};
+
+constexpr int numPalavrasChave = sizeof(palavrasChave) / sizeof(palavrasChave[0]);
+
+/*
+    FNV-1a dos tokens: enumeradores, valores, nomes e palavras-chave. As
+    tabelas geradas guardam o hash dos tokens para os quais foram feitas, e
+    parser_lr.h não compila com tabelas de outro lexer (um enum reordenado,
+    por exemplo)
+*/
+constexpr uint64_t hashTokens()
+{
+    uint64_t h = 14695981039346656037ull;
+    auto misturar = [&h](string_view texto, int valor)
+    {
+        for (char c : texto)
+        {
+            h ^= (unsigned char)c;
+            h *= 1099511628211ull;
+        }
+
+        for (int i = 0; i < 4; i++)
+        {
+            h ^= (unsigned(valor) >> (8 * i)) & 0xff;
+            h *= 1099511628211ull;
+        }
+    };
+
+#define X(tk, nome, palavra) \
+    misturar(#tk, Tokens::tk); \
+    misturar(nome, 0);         \
+    misturar(palavra, 0);
+    TOKENS_CEPE(X)
+#undef X
+#define X(tk, palavra) misturar(palavra, Tokens::tk);
+    GRAFIAS_ACENTUADAS(X)
+#undef X
+
+    misturar("", FIM_TOKENS);
+    return h;
+}
+
+/*
+    Hash perfeito das palavras-chave, montado em tempo de compilação.
+    Olha só para o tamanho e para o primeiro, o do meio e o último caractere,
+    então classificar um lexema custa um hash e no máximo uma comparação
+*/
+constexpr unsigned TAMANHO_HASH_PALAVRAS = 64;
+
+constexpr unsigned hashPalavra(const char *s, size_t n, unsigned semente)
+{
+    const unsigned h = unsigned(n) * 0x9E3779B1u ^
+                       (unsigned char)s[0] * semente ^
+                       (unsigned char)s[n / 2] * (semente >> 7) ^
+                       (unsigned char)s[n - 1];
+    return (h ^ (h >> 13)) % TAMANHO_HASH_PALAVRAS;
+}
+
+struct TabelaPalavras
+{
+    unsigned semente;
+    signed char entradas[TAMANHO_HASH_PALAVRAS]; // Índice em palavrasChave, ou -1
+};
+
+// Procura uma semente que não gere colisões entre as palavras-chave
+constexpr TabelaPalavras construirTabelaPalavras()
+{
+    for (unsigned semente = 1; semente < 100000; semente++)
+    {
+        TabelaPalavras tabela{semente, {}};
+        for (unsigned i = 0; i < TAMANHO_HASH_PALAVRAS; i++)
+            tabela.entradas[i] = -1;
+
+        bool colidiu = false;
+        for (int i = 0; i < numPalavrasChave && !colidiu; i++)
+        {
+            const string_view palavra = palavrasChave[i].palavra;
+            if (palavra.empty())
+                continue;
+
+            const unsigned h = hashPalavra(palavra.data(), palavra.size(), semente);
+            if (tabela.entradas[h] != -1)
+                colidiu = true;
+            else
+                tabela.entradas[h] = (signed char)i;
+        }
+
+        if (!colidiu)
+            return tabela;
+    }
+
+    return TabelaPalavras{0, {}};
+}
+
+constexpr TabelaPalavras tabelaPalavras = construirTabelaPalavras();
+static_assert(tabelaPalavras.semente != 0, "Nenhuma semente sem colisões para as palavras-chave");
+
+// Retorna o tipo da palavra-chave, ou Tokens::ID se o lexema não for reservado
+inline int classificarPalavra(const char *s, size_t n)
+{
+    const int i = tabelaPalavras.entradas[hashPalavra(s, n, tabelaPalavras.semente)];
+
+    if (i >= 0 && palavrasChave[i].palavra == string_view(s, n))
+        return palavrasChave[i].tipo;
+
+    return Tokens::ID;
+}
+
+/*
+    Token sem dono de memória: o lexema é referenciado no buffer da fonte
+    por deslocamento e tamanho. Identificadores carregam ainda o id do
+    símbolo na tabela de símbolos, para serem comparados como inteiros.
+    Linha e coluna não são guardadas: saem de Fonte::linhaColuna() quando
+    alguém precisa delas
+*/
+struct Token
+{
+    int tipo;
+    uint32_t inicio;  // Deslocamento do lexema na fonte
+    uint32_t tamanho; // Tamanho do lexema em bytes
+    int simbolo;      // Id na TabelaSimbolos se for ID, senão -1
+};
+
+static_assert(is_trivially_copyable<Token>::value, "Token deve continuar sendo POD");
+
+/*
+    Sequência de tokens guardada em vetores paralelos (structure of arrays).
+    O tipo cabe em 16 bits, já que os tokens que não são caracteres vão de
+    256 até FIM_TOKENS; EOF nunca é guardado
+*/
+struct FluxoTokens
+{
+    vector<uint16_t> tipos;
+    vector<uint32_t> inicios;
+    vector<uint32_t> tamanhos;
+    vector<int32_t> simbolos;
+
+    size_t tamanho() const { return tipos.size(); }
+
+    void reservar(size_t n)
+    {
+        tipos.reserve(n);
+        inicios.reserve(n);
+        tamanhos.reserve(n);
+        simbolos.reserve(n);
+    }
+
+    void adicionar(const Token &tk)
+    {
+        tipos.push_back(tk.tipo);
+        inicios.push_back(tk.inicio);
+        tamanhos.push_back(tk.tamanho);
+        simbolos.push_back(tk.simbolo);
+    }
+
+    Token operator[](size_t i) const { return Token{tipos[i], inicios[i], tamanhos[i], simbolos[i]}; }
+
+    size_t bytesPorToken() const { return sizeof(uint16_t) + 2 * sizeof(uint32_t) + sizeof(int32_t); }
+};
+
+static_assert(FIM_TOKENS <= 65536, "Os tipos de token precisam caber em 16 bits");
+
+struct LinhaColuna
+{
+    int linha;
+    int coluna;
+};
+
+/*
+    Tabela de identificadores. Cada nome distinto recebe um id pequeno e
+    sequencial, na ordem em que aparece pela primeira vez. Os nomes são
+    copiados para blocos próprios da tabela, então continuam válidos mesmo
+    se a fonte for editada ou fechada
+*/
+class TabelaSimbolos
+{
+public:
+    int internar(string_view nome)
+    {
+        auto it = ids.find(nome);
+        if (it != ids.end())
+            return it->second;
+
+        const int id = nomes.size();
+        const string_view copia = guardar(nome);
+        ids.emplace(copia, id);
+        nomes.push_back(copia);
+        return id;
+    }
+
+    string_view nome(int id) const { return nomes[id]; }
+    int tamanho() const { return nomes.size(); }
+
+    // Esquece todos os nomes, mas guarda o primeiro bloco e a capacidade da
+    // tabela para reaproveitar no próximo arquivo
+    void limpar()
+    {
+        ids.clear();
+        nomes.clear();
+        blocos.resize(min<size_t>(blocos.size(), 1));
+        livre = blocos.empty() ? nullptr : blocos[0].get();
+        restante = blocos.empty() ? 0 : tamanhoPrimeiroBloco;
+    }
+
+private:
+    static constexpr size_t TAMANHO_BLOCO = 64 * 1024;
+
+    unordered_map<string_view, int> ids;
+    vector<string_view> nomes;
+
+    // Os nomes ficam em blocos grandes, então internar não aloca a cada identificador
+    vector<unique_ptr<char[]>> blocos;
+    char *livre = nullptr;
+    size_t restante = 0;
+    size_t tamanhoPrimeiroBloco = 0;
+
+    string_view guardar(string_view nome)
+    {
+        if (nome.size() > restante)
+        {
+            const size_t tamanho = max(nome.size(), TAMANHO_BLOCO);
+            if (blocos.empty())
+                tamanhoPrimeiroBloco = tamanho;
+            blocos.emplace_back(new char[tamanho]);
+            livre = blocos.back().get();
+            restante = tamanho;
+        }
+
+        char *destino = livre;
+        memcpy(destino, nome.data(), nome.size());
+        livre += nome.size();
+        restante -= nome.size();
+        return string_view(destino, nome.size());
+    }
+};
+
+/*
+    Arquivo fonte inteiro visto como um único bloco contíguo de bytes.
+    Sempre que possível o arquivo é mapeado em memória; se o mapeamento
+    falhar, ele é lido de uma vez só para um buffer.
+*/
+class Fonte
+{
+public:
+    Fonte() = default;
+    Fonte(const Fonte &) = delete;
+    Fonte &operator=(const Fonte &) = delete;
+    ~Fonte() { fechar(); }
+
+    // Usa um texto em memória como fonte (útil para entradas pequenas e testes)
+    void carregarTexto(string_view texto)
+    {
+        // O texto é copiado antes de fechar, pois pode apontar para a própria fonte
+        vector<char> novo(texto.begin(), texto.end());
+        fechar();
+        copia.swap(novo);
+        dados = copia.data();
+        tamanho = copia.size();
+    }
+
+    // Troca os bytes [inicio, inicio + removidos) pelo texto inserido; uma
+    // edição que passa do fim da fonte é recusada e não muda nada.
+    // Uma fonte mapeada passa a ser uma cópia em memória antes da edição
+    bool substituir(uint32_t inicio, uint32_t removidos, string_view inseridos)
+    {
+        if (inicio > tamanho || removidos > tamanho - inicio)
+            return false;
+
+        if (mapeado)
+            carregarTexto(string_view(dados, tamanho));
+
+        copia.erase(copia.begin() + inicio, copia.begin() + inicio + removidos);
+        copia.insert(copia.begin() + inicio, inseridos.begin(), inseridos.end());
+        iniciosLinhas.clear();
+        cursorLinha = 0;
+        dados = copia.data();
+        tamanho = copia.size();
+        return true;
+    }
+
+    bool abrir(const string &caminho)
+    {
+        fechar();
+
+#ifdef _WIN32
+        arquivo = CreateFileA(caminho.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+                              OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+        if (arquivo == INVALID_HANDLE_VALUE)
+            return false;
+
+        LARGE_INTEGER tam;
+        if (GetFileSizeEx(arquivo, &tam) && tam.QuadPart > 0)
+        {
+            mapa = CreateFileMapping(arquivo, NULL, PAGE_READONLY, 0, 0, NULL);
+            if (mapa != NULL)
+                dados = (const char *)MapViewOfFile(mapa, FILE_MAP_READ, 0, 0, 0);
+            if (dados != nullptr)
+            {
+                tamanho = (size_t)tam.QuadPart;
+                mapeado = true;
+                return true;
+            }
+        }
+#else
+        int fd = open(caminho.c_str(), O_RDONLY);
+        if (fd < 0)
+            return false;
+
+        struct stat info;
+        if (fstat(fd, &info) == 0 && info.st_size > 0)
+        {
+            void *ptr = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (ptr != MAP_FAILED)
+            {
+                madvise(ptr, info.st_size, MADV_SEQUENTIAL);
+                dados = (const char *)ptr;
+                tamanho = info.st_size;
+                mapeado = true;
+                close(fd);
+                return true;
+            }
+        }
+        close(fd);
+#endif
+
+        // Sem mapeamento (arquivo vazio, pipe etc.): lê tudo de uma vez
+        ifstream file(caminho, ios::binary);
+        if (!file)
+            return false;
+
+        copia.assign(istreambuf_iterator<char>(file), istreambuf_iterator<char>());
+        dados = copia.data();
+        tamanho = copia.size();
+        return true;
+    }
+
+    void fechar()
+    {
+        if (mapeado)
+        {
+#ifdef _WIN32
+            UnmapViewOfFile(dados);
+#else
+            munmap((void *)dados, tamanho);
+#endif
+        }
+#ifdef _WIN32
+        if (mapa != NULL)
+            CloseHandle(mapa);
+        if (arquivo != INVALID_HANDLE_VALUE)
+            CloseHandle(arquivo);
+        mapa = NULL;
+        arquivo = INVALID_HANDLE_VALUE;
+#endif
+
+        copia.clear();
+        iniciosLinhas.clear();
+        cursorLinha = 0;
+        dados = nullptr;
+        tamanho = 0;
+        mapeado = false;
+    }
+
+    const char *inicio() const { return dados; }
+    const char *fim() const { return dados + tamanho; }
+    size_t bytes() const { return tamanho; }
+
+    string_view lexema(const Token &tk) const { return string_view(dados + tk.inicio, tk.tamanho); }
+
+    /*
+        Linha e coluna de um deslocamento na fonte. O índice com o começo de
+        cada linha só é montado na primeira chamada; a coluna é contada a
+        partir do começo da linha: tab anda quatro colunas, um caractere
+        UTF-8 válido anda uma, e um byte que não faz parte de um caractere
+        válido (um byte de continuação solto, por exemplo) anda uma sozinho.
+        Quem pede os tokens em ordem (o lexer imprimindo todos, por exemplo)
+        continua a contagem de onde a chamada anterior parou na mesma linha,
+        em vez de recontar a linha desde o começo
+    */
+    LinhaColuna linhaColuna(uint32_t deslocamento) const
+    {
+        if (iniciosLinhas.empty())
+            indexarLinhas();
+
+        const size_t linha = upper_bound(iniciosLinhas.begin(), iniciosLinhas.end(), deslocamento) - iniciosLinhas.begin();
+
+        if (linha != cursorLinha || deslocamento < cursorDeslocamento)
+        {
+            cursorLinha = linha;
+            cursorDeslocamento = iniciosLinhas[linha - 1];
+            cursorColuna = 1;
+        }
+
+        int coluna = cursorColuna;
+        const char *parou = avancarColunas(dados + cursorDeslocamento, dados + deslocamento, coluna);
+
+        // Só guarda posições em que a contagem pode recomeçar (começo de caractere)
+        if (parou == dados + deslocamento)
+        {
+            cursorDeslocamento = deslocamento;
+            cursorColuna = coluna;
+        }
+
+        return {int(linha), coluna};
+    }
+
+private:
+    const char *dados = nullptr;
+    size_t tamanho = 0;
+    bool mapeado = false;
+    vector<char> copia;
+
+    // Deslocamento do começo de cada linha, montado sob demanda
+    mutable vector<uint32_t> iniciosLinhas;
+
+    // Onde a última contagem de colunas parou; linha 0 é nenhuma
+    mutable size_t cursorLinha = 0;
+    mutable uint32_t cursorDeslocamento = 0;
+    mutable int cursorColuna = 1;
+
+    void indexarLinhas() const
+    {
+        iniciosLinhas.push_back(0);
+
+        const char *p = dados;
+        const char *const fimDados = dados + tamanho;
+        while (p < fimDados && (p = (const char *)memchr(p, '\n', fimDados - p)) != nullptr)
+        {
+            p++;
+            iniciosLinhas.push_back(p - dados);
+        }
+    }
+
+    // Anda de p até alvo somando as colunas; retorna onde parou, que passa
+    // de alvo quando alvo cai no meio de um caractere
+    const char *avancarColunas(const char *p, const char *alvo, int &coluna) const
+    {
+        const char *const fimDados = dados + tamanho;
+
+        while (p < alvo)
+        {
+            const unsigned char c = *p;
+            if (c < 0x80)
+                p++;
+            else
+            {
+                const int n = tamanhoUtf8(p, fimDados);
+                p += n == 0 ? 1 : n;
+            }
+            coluna += c == '\t' ? 4 : 1;
+        }
+
+        return p;
+    }
+
+#ifdef _WIN32
+    HANDLE arquivo = INVALID_HANDLE_VALUE;
+    HANDLE mapa = NULL;
+#endif
+};
+
+// Quantos bytes depois do fim de um token o lexer pode ter examinado para
+// decidir onde ele termina (uma sequência UTF-8 de até 4 bytes)
+const uint32_t ALCANCE_LEXER = 4;
+
+// Primeiro byte não-ASCII de um identificador: o resto do identificador é
+// lido fora do autômato, validando o UTF-8 (veja Lexer::continuarIdentificador)
+const int ID_NAO_ASCII = -4;
+
+/*
+    Especificação dos tokens. O autômato do lexer é gerado a partir dela em
+    tempo de compilação (automato.h); a ordem desempata lexemas do mesmo
+    tamanho. Palavras-chave saem de ID depois, pelo hash perfeito.
+
+    O autômato não tem como validar UTF-8, então ele para no primeiro byte
+    não-ASCII de um identificador e o lexer continua dali, parando no
+    primeiro byte inválido. Se o autômato fosse até o fim da sequência de
+    bytes altos e o lexer depois recuasse, uma sequência inválida longa
+    seria percorrida de novo a cada token, em tempo quadrático
+*/
+constexpr RegraLexica regrasLexicas[] = {
+    {"[ \\t\\n]+", TOKEN_IGNORADO},
+    {"[a-zA-Z][a-zA-Z0-9]*", Tokens::ID},
+    {"[\\x80-\\xff]", ID_NAO_ASCII},
+    {"[0-9]+", Tokens::INT_NUM},
+    {"[0-9]+\\.[0-9]*", Tokens::FLOAT_NUM},
+    {"\"[^\"]*\"?", Tokens::STRING_LIT}, // Uma string sem fim vai até o fim da entrada
+    {"\\+=", Tokens::MAIS_IGUAL},
+    {"-=", Tokens::MENOS_IGUAL},
+    {"\\*=", Tokens::VEZES_IGUAL},
+    {"/=", Tokens::DIVIDIDO_IGUAL},
+    {">=", Tokens::MAIOR_IGUAL},
+    {"<=", Tokens::MENOR_IGUAL},
+    {"[\\x00-\\xff]", TOKEN_CARACTERE},
+};
+
+constexpr Automato automato = construirAutomato(regrasLexicas, sizeof(regrasLexicas) / sizeof(regrasLexicas[0]));
+static_assert(automato.erro == nullptr, "Especificação do lexer inválida");
+
+/*
+    Lexer sob demanda: cada chamada a proximo() reconhece só o token seguinte,
+    direto do buffer da fonte. No fim da entrada devolve sempre um token EOF
+*/
+class Lexer
+{
+public:
+    Lexer(const Fonte &fonte, TabelaSimbolos &simbolos)
+        : base(fonte.inicio()), p(fonte.inicio()), fim(fonte.fim()), simbolos(simbolos)
+    {
+    }
+
+    // Reconhece só o trecho [inicio, fim) da fonte, que deve começar fora de uma string.
+    // Os deslocamentos dos tokens continuam relativos ao começo da fonte
+    Lexer(const Fonte &fonte, TabelaSimbolos &simbolos, uint32_t inicio, uint32_t fim)
+        : base(fonte.inicio()), p(fonte.inicio() + inicio), fim(fonte.inicio() + fim), simbolos(simbolos)
+    {
+    }
+
+    Token proximo()
+    {
+        if (temEspiado)
+        {
+            temEspiado = false;
+            return espiado;
+        }
+
+        return reconhecer();
+    }
+
+    const Token &espiar()
+    {
+        if (!temEspiado)
+        {
+            espiado = reconhecer();
+            temEspiado = true;
+        }
+
+        return espiado;
+    }
+
+private:
+    const char *base;
+    const char *p;
+    const char *fim;
+    TabelaSimbolos &simbolos;
+
+    Token espiado;
+    bool temEspiado = false;
+
+    // Avança por letras e dígitos ASCII e caracteres UTF-8 válidos, até o
+    // primeiro byte que não pode continuar o identificador
+    const char *continuarIdentificador(const char *q) const
+    {
+        while (q < fim)
+        {
+            if ((unsigned char)*q < 0x80)
+            {
+                const char *depois = varredura.fimAlfanumerico(q, fim);
+                if (depois == q)
+                    break;
+                q = depois;
+                continue;
+            }
+
+            const int n = tamanhoUtf8(q, fim);
+            if (n == 0)
+                break;
+            q += n;
+        }
+
+        return q;
+    }
+
+    Token reconhecer()
+    {
+        while (p < fim)
+        {
+            const char *comeco = p;
+
+            // Um só laço de consulta à tabela por byte; estados que ficam em laço
+            // numa classe conhecida pulam a sequência inteira com varredura.h
+            unsigned estado = ESTADO_INICIAL;
+            do
+            {
+                const unsigned proximo = automato.porByte[estado][(unsigned char)*p];
+                if (proximo == ESTADO_MORTO)
+                    break;
+
+                estado = proximo;
+                p++;
+
+                switch (automato.aceleracao[estado])
+                {
+                case ACELERAR_STRING:
+                    p = varredura.fimString(p, fim);
+                    break;
+                case ACELERAR_ALFANUMERICO:
+                    p = varredura.fimAlfanumerico(p, fim);
+                    break;
+                case ACELERAR_DIGITOS:
+                    p = varredura.fimDigitos(p, fim);
+                    break;
+                case ACELERAR_ESPACOS:
+                    p = varredura.pularEspacos(p, fim);
+                    break;
+                }
+            } while (p < fim);
+
+            Token tk;
+            tk.tipo = automato.aceita[estado];
+            tk.simbolo = -1;
+
+            if (tk.tipo == TOKEN_IGNORADO)
+                continue;
+
+            if (tk.tipo == TOKEN_CARACTERE)
+                tk.tipo = (unsigned char)*comeco;
+            else if (tk.tipo == ID_NAO_ASCII)
+            {
+                // Um byte que não começa um caractere UTF-8 válido vira um token sozinho
+                const int n = tamanhoUtf8(comeco, fim);
+                if (n == 0)
+                    tk.tipo = (unsigned char)*comeco;
+                else
+                {
+                    p = continuarIdentificador(comeco + n);
+                    tk.tipo = Tokens::ID;
+                }
+            }
+
+            if (tk.tipo == Tokens::ID)
+            {
+                if (p < fim && (unsigned char)*p >= 0x80)
+                    p = continuarIdentificador(p);
+
+                tk.tipo = classificarPalavra(comeco, p - comeco);
+
+                if (tk.tipo == Tokens::ID)
+                    tk.simbolo = simbolos.internar(string_view(comeco, p - comeco));
+            }
+
+            tk.inicio = comeco - base;
+            tk.tamanho = p - comeco;
+
+            return tk;
+        }
+
+        return Token{EOF, uint32_t(fim - base), 0, -1};
+    }
+};
+
+#endif
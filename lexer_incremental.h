@@ -0,0 +1,129 @@
+/*
+    Relexing incremental para edições pequenas (integração com editores).
+
+    O Lexer não guarda estado entre tokens além da posição, então qualquer
+    começo de token é um ponto seguro de recomeço. Depois de uma edição, só
+    é preciso reconhecer de novo a partir do primeiro token que pode ter sido
+    afetado até que um token novo caia exatamente no começo de um token
+    antigo posterior à edição. Dali em diante os tokens antigos continuam
+    valendo, só com os deslocamentos ajustados
+*/
+
+#ifndef CEPE_LEXER_INCREMENTAL_H
+#define CEPE_LEXER_INCREMENTAL_H
+
+#include <algorithm>
+#include "lexer.h"
+
+using namespace std;
+
+// Os bytes [inicio, inicio + removidos) do texto antigo foram trocados por inseridos
+struct Edicao
+{
+    uint32_t inicio;
+    uint32_t removidos;
+    string_view inseridos;
+};
+
+// Trecho da sequência de tokens que foi trocado: os tokens [primeiro, primeiro + removidos)
+// antigos viraram os tokens [primeiro, primeiro + inseridos) novos
+struct TrechoRelexado
+{
+    size_t primeiro;
+    size_t removidos;
+    size_t inseridos;
+};
+
+// Troca os elementos [primeiro, primeiro + removidos) de v pelos de novos
+template <typename T>
+void trocarTrecho(vector<T> &v, size_t primeiro, size_t removidos, const vector<T> &novos)
+{
+    if (novos.size() <= removidos)
+    {
+        copy(novos.begin(), novos.end(), v.begin() + primeiro);
+        v.erase(v.begin() + primeiro + novos.size(), v.begin() + primeiro + removidos);
+    }
+    else
+    {
+        copy(novos.begin(), novos.begin() + removidos, v.begin() + primeiro);
+        v.insert(v.begin() + primeiro + removidos, novos.begin() + removidos, novos.end());
+    }
+}
+
+/*
+    Atualiza tokens (reconhecidos do texto antes da edição) para a fonte já
+    editada. Identificadores novos são internados na mesma tabela de símbolos,
+    então os ids dos tokens que não mudaram continuam válidos
+*/
+inline TrechoRelexado relexar(const Fonte &fonte, FluxoTokens &tokens, TabelaSimbolos &simbolos, const Edicao &edicao)
+{
+    const int64_t delta = int64_t(edicao.inseridos.size()) - int64_t(edicao.removidos);
+    const uint32_t fimAntigo = edicao.inicio + edicao.removidos;
+    const uint32_t fimNovo = edicao.inicio + edicao.inseridos.size();
+    const size_t total = tokens.tamanho();
+
+    // O primeiro token afetado é o primeiro cujo fim está a menos de ALCANCE_LEXER
+    // bytes da edição: o lexer pode ter olhado esses bytes para decidir onde ele terminava
+    size_t primeiro = 0;
+    for (size_t passo = total; passo > 0;)
+    {
+        const size_t metade = passo / 2;
+        const size_t i = primeiro + metade;
+
+        if (tokens.inicios[i] + tokens.tamanhos[i] + ALCANCE_LEXER <= edicao.inicio)
+        {
+            primeiro = i + 1;
+            passo -= metade + 1;
+        }
+        else
+            passo = metade;
+    }
+
+    // Recomeça logo depois do último token não afetado
+    const uint32_t recomeco = primeiro > 0 ? tokens.inicios[primeiro - 1] + tokens.tamanhos[primeiro - 1] : 0;
+
+    Lexer lexer(fonte, simbolos, recomeco, fonte.bytes());
+    FluxoTokens novos;
+
+    // Candidato a ressincronização entre os tokens antigos depois da edição
+    size_t j = primeiro;
+
+    while (true)
+    {
+        const Token tk = lexer.proximo();
+
+        if (tk.tipo == EOF)
+        {
+            j = total;
+            break;
+        }
+
+        if (tk.inicio >= fimNovo)
+        {
+            while (j < total && (tokens.inicios[j] < fimAntigo || tokens.inicios[j] + delta < tk.inicio))
+                j++;
+
+            // Mesmo ponto do texto que não mudou: daqui em diante tudo se repete
+            if (j < total && tokens.inicios[j] + delta == tk.inicio)
+            {
+                for (size_t k = j; k < total; k++)
+                    tokens.inicios[k] = uint32_t(tokens.inicios[k] + delta);
+                break;
+            }
+        }
+
+        novos.adicionar(tk);
+    }
+
+    // Troca os tokens [primeiro, j) pelos novos
+    const size_t removidos = j - primeiro;
+
+    trocarTrecho(tokens.tipos, primeiro, removidos, novos.tipos);
+    trocarTrecho(tokens.inicios, primeiro, removidos, novos.inicios);
+    trocarTrecho(tokens.tamanhos, primeiro, removidos, novos.tamanhos);
+    trocarTrecho(tokens.simbolos, primeiro, removidos, novos.simbolos);
+
+    return {primeiro, removidos, novos.tamanho()};
+}
+
+#endif
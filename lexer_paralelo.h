@@ -0,0 +1,149 @@
+/*
+    Lexing paralelo de arquivos grandes.
+
+    A fonte é dividida em pedaços que começam sempre logo depois de uma
+    quebra de linha que está fora de uma string, então cada pedaço pode ser
+    reconhecido por um Lexer independente. Depois os pedaços são costurados
+    e os ids dos identificadores são renumerados na ordem em que aparecem no
+    arquivo, dando exatamente o mesmo resultado do lexer sequencial
+*/
+
+#ifndef CEPE_LEXER_PARALELO_H
+#define CEPE_LEXER_PARALELO_H
+
+#include <cstring>
+#include "lexer.h"
+#include "threads.h"
+#include "instrumentacao.h"
+
+using namespace std;
+
+// Pedaços menores que isso não compensam o custo de dividir
+const size_t TAMANHO_MINIMO_PEDACO = 64 * 1024;
+
+// Avança p até logo depois de uma quebra de linha que esteja fora de string.
+// dentroString diz se p está no meio de uma string literal
+inline const char *avancarParaFronteira(const char *p, const char *fim, bool dentroString)
+{
+    while (p < fim)
+    {
+        if (dentroString)
+        {
+            const char *aspa = (const char *)memchr(p, '"', fim - p);
+            if (aspa == nullptr)
+                return fim;
+
+            p = aspa + 1;
+            dentroString = false;
+            continue;
+        }
+
+        // Fora de string: procura a próxima quebra de linha, a menos que
+        // uma aspa apareça antes dela
+        const char *quebra = (const char *)memchr(p, '\n', fim - p);
+        if (quebra == nullptr)
+            return fim;
+
+        const char *aspa = (const char *)memchr(p, '"', quebra - p);
+        if (aspa == nullptr)
+            return quebra + 1;
+
+        p = aspa + 1;
+        dentroString = true;
+    }
+
+    return fim;
+}
+
+// Reconhece todos os tokens da fonte usando as threads do pool. O resultado
+// (tokens e tabela de símbolos) é idêntico ao de rodar o Lexer sequencial
+inline FluxoTokens lexarParalelo(const Fonte &fonte, TabelaSimbolos &simbolos, PoolThreads &pool)
+{
+    CEPE_FASE(FASE_LEXER);
+
+    const char *const base = fonte.inicio();
+    const size_t total = fonte.bytes();
+
+    int numPedacos = min<size_t>(pool.tamanho() * 4, total / TAMANHO_MINIMO_PEDACO);
+    if (numPedacos < 1)
+        numPedacos = 1;
+
+    // 1. Fronteiras provisórias e quantidade de aspas em cada pedaço provisório,
+    // para saber se cada fronteira cai dentro de uma string
+    vector<size_t> fronteiras(numPedacos + 1);
+    for (int i = 0; i <= numPedacos; i++)
+        fronteiras[i] = total * i / numPedacos;
+
+    vector<size_t> aspas(numPedacos, 0);
+    pool.paraCada(numPedacos, [&](int i)
+                  { aspas[i] = count(base + fronteiras[i], base + fronteiras[i + 1], '"'); });
+
+    // 2. Move cada fronteira para depois de uma quebra de linha fora de string
+    size_t aspasAntes = 0;
+    for (int i = 1; i < numPedacos; i++)
+    {
+        aspasAntes += aspas[i - 1];
+        const bool dentroString = aspasAntes % 2 == 1;
+
+        size_t fronteira = avancarParaFronteira(base + fronteiras[i], base + total, dentroString) - base;
+        fronteiras[i] = max(fronteira, fronteiras[i - 1]);
+    }
+
+    // 3. Cada pedaço é reconhecido com sua própria tabela de símbolos
+    vector<FluxoTokens> tokensPedaco(numPedacos);
+    vector<TabelaSimbolos> simbolosPedaco(numPedacos);
+
+    pool.paraCada(numPedacos, [&](int i)
+                  {
+                      Lexer lexer(fonte, simbolosPedaco[i], fronteiras[i], fronteiras[i + 1]);
+                      FluxoTokens &tokens = tokensPedaco[i];
+                      tokens.reservar((fronteiras[i + 1] - fronteiras[i]) / 4 + 1);
+
+                      for (Token tk = lexer.proximo(); tk.tipo != EOF; tk = lexer.proximo())
+                          tokens.adicionar(tk); });
+
+    // 4. Renumera os símbolos de cada pedaço na ordem dos pedaços, que é a
+    // ordem de primeira aparição no arquivo
+    vector<vector<int>> idsGlobais(numPedacos);
+    vector<size_t> inicioSaida(numPedacos + 1, 0);
+
+    for (int i = 0; i < numPedacos; i++)
+    {
+        idsGlobais[i].resize(simbolosPedaco[i].tamanho());
+        for (int id = 0; id < simbolosPedaco[i].tamanho(); id++)
+            idsGlobais[i][id] = simbolos.internar(simbolosPedaco[i].nome(id));
+
+        inicioSaida[i + 1] = inicioSaida[i] + tokensPedaco[i].tamanho();
+    }
+
+    // 5. Costura os pedaços, corrigindo os ids. Os deslocamentos já são
+    // relativos ao começo da fonte
+    FluxoTokens tokens;
+    const size_t totalTokens = inicioSaida[numPedacos];
+    CEPE_SOMAR(TOKENS, totalTokens);
+    tokens.tipos.resize(totalTokens);
+    tokens.inicios.resize(totalTokens);
+    tokens.tamanhos.resize(totalTokens);
+    tokens.simbolos.resize(totalTokens);
+
+    pool.paraCada(numPedacos, [&](int i)
+                  {
+                      FluxoTokens &pedaco = tokensPedaco[i];
+                      const size_t saida = inicioSaida[i];
+
+                      copy(pedaco.tipos.begin(), pedaco.tipos.end(), tokens.tipos.begin() + saida);
+                      copy(pedaco.inicios.begin(), pedaco.inicios.end(), tokens.inicios.begin() + saida);
+                      copy(pedaco.tamanhos.begin(), pedaco.tamanhos.end(), tokens.tamanhos.begin() + saida);
+
+                      for (size_t k = 0; k < pedaco.tamanho(); k++)
+                      {
+                          const int simbolo = pedaco.simbolos[k];
+                          tokens.simbolos[saida + k] = simbolo >= 0 ? idsGlobais[i][simbolo] : -1;
+                      }
+
+                      pedaco = FluxoTokens(); });
+
+    return tokens;
+}
+
+#endif
@@ -8,164 +8,431 @@
 #include <iostream>
 #include <vector>
 #include <map>
+#include <unordered_map>
 #include <chrono>
 #include <algorithm>
-#include <stack>
+#include <bitset>
+#include <cstdint>
+#include <cstring>
+#include <cstdio>
+#include <cctype>
+#include <fstream>
+#include "lexer.h"
+#include "parser_lr.h"
+#include "ast.h"
+#include "threads.h"
+#include "instrumentacao.h"
 
 using namespace std;
 using namespace std::chrono;
 
-const int terminalInt = 10;
-
-enum NonTerminals
-{
-    B = 512,
-    S,
-    E,
-    T
-};
-
 struct InfoNaoTerminal
 {
     int indexComeco; // Informa quando começam as regras para aquele não terminal na gramática
     int indexFim;    // Informa quando terminam as regras para aquele não terminal
 };
 
+// Conjunto de terminais, com um bit por coluna da tabela ACTION
+const int MAX_TERMINAIS = 128;
+typedef bitset<MAX_TERMINAIS> ConjuntoTerminais;
+
+/*
+    Os conjuntos de lookaheads são internados: cada conjunto diferente é
+    guardado uma vez só em conjuntos, e as posições guardam só o índice.
+    Como conjuntos iguais têm o mesmo índice, comparar lookaheads é
+    comparar inteiros
+*/
+vector<ConjuntoTerminais> conjuntos;
+unordered_map<ConjuntoTerminais, uint32_t> indiceConjunto;
+
+uint32_t internarConjunto(const ConjuntoTerminais &conjunto)
+{
+    auto [existente, novo] = indiceConjunto.try_emplace(conjunto, conjuntos.size());
+    if (novo)
+        conjuntos.push_back(conjunto);
+
+    return existente->second;
+}
+
 /*
     Códifica uma "posição"
-    Exemplo: Posicao{{E, E, '+', T}, 1, {'+', '-', EOF}} == E -> E . + T {+, -, EOF}
+    Exemplo: E -> E . + T {+, -, EOF} é a regra 1 com posicao 2, e os lookaheads
+    são o índice de {+, -, EOF} em conjuntos
 
-    O "corpo" de uma posição é a mistura do não terminal com a regra
+    A regra e a posição ficam empacotadas num inteiro só (o "corpo" da
+    posição), então ordenar pelo corpo ordena por regra e depois por posição
 */
 struct Posicao
 {
-    int regra;              // Index da regra na gramática para esse não terminal
-    int posicao;            // Posição específica onde estamos na regra
-    vector<int> lookaheads; // Conjunto de elementos que podem resultar numa redução
+    uint32_t corpo;      // regra << 8 | posicao (regras de até 255 símbolos)
+    uint32_t lookaheads; // Índice em conjuntos
+
+    int regra() const { return corpo >> 8; }
+    int posicao() const { return corpo & 0xff; }
+};
+
+inline uint32_t codificarCorpo(int regra, int posicao) { return uint32_t(regra) << 8 | uint32_t(posicao); }
+
+/*
+    Conjuntos de posições (kernels e estados) ficam todos seguidos numa arena,
+    ordenados pelo corpo, e cada um é só um trecho dela. Montar e comparar
+    estados não aloca nada por posição
+*/
+struct Trecho
+{
+    uint32_t inicio;
+    uint32_t tamanho;
 };
 
-bool operator==(Posicao pos1, Posicao pos2)
+// Kernels de todos os estados: as posições que vieram do shift que criou o
+// estado, antes do fechamento
+vector<Posicao> arenaKernels;
+vector<Trecho> kernels;
+
+// Estados já fechados
+vector<Posicao> arenaEstados;
+vector<Trecho> estados;
+
+/*
+    Dois estados com o mesmo kernel são o mesmo estado, então cada kernel novo
+    é procurado entre os já criados antes de virar um estado. Como o kernel
+    está ordenado e os lookaheads são internados, a comparação é direta
+*/
+struct HashKernel
 {
-    return (
-        pos1.regra == pos2.regra &&
-        pos1.posicao == pos2.posicao &&
-        pos1.lookaheads == pos2.lookaheads);
-}
+    size_t operator()(Trecho kernel) const
+    {
+        size_t h = kernel.tamanho;
+
+        for (uint32_t k = kernel.inicio; k < kernel.inicio + kernel.tamanho; k++)
+            h = (h * 1000003 ^ arenaKernels[k].corpo) * 31 + arenaKernels[k].lookaheads;
+
+        return h;
+    }
+};
+
+struct IgualKernel
+{
+    bool operator()(Trecho a, Trecho b) const
+    {
+        if (a.tamanho != b.tamanho)
+            return false;
+
+        for (uint32_t k = 0; k < a.tamanho; k++)
+        {
+            const Posicao &pa = arenaKernels[a.inicio + k], &pb = arenaKernels[b.inicio + k];
+            if (pa.corpo != pb.corpo || pa.lookaheads != pb.lookaheads)
+                return false;
+        }
+
+        return true;
+    }
+};
+
+/*
+    Gramática, lida do arquivo de especificação (veja gramatica.bnf).
+
+    Os símbolos têm ids densos: os terminais vão de 0 a numTerminais - 1 e o
+    id de cada um é a sua coluna na tabela ACTION (0 é a dos tokens que não
+    aparecem na gramática e 1 é o EOF). Os não terminais vêm logo depois, de
+    numTerminais a numSimbolos - 1, na ordem em que são definidos
+*/
 
-map<int, string> simbolosNomes = {
-    {EOF, "EOF"},
-    {S, "S"},
-    {E, "E"},
-    {T, "T"},
-    {B, "B"},
-    {terminalInt, "int"},
-    {'+', "+"},
-    {'-', "-"}};
-
-// Gramática contendo todas as regras
 // Cada regra é armazenada como um vetor de inteiros, onde o primeiro símbolo
-// é o não terminal formado a partir dos próximos símbolos na regra
-vector<vector<int>> gramatica = {
-    {S, E},
-    {E, E, '+', T},
-    {E, E, '-', T},
-    {E, T},
-    {T, terminalInt}};
+// é o não terminal formado a partir dos próximos símbolos na regra. A regra 0
+// é a inicial, inicio' -> <primeiro não terminal do arquivo>, e as regras de
+// cada não terminal ficam seguidas
+vector<vector<int>> gramatica;
+vector<string> nomesSimbolos;
+vector<int> tokenDoTerminal; // Tipo de token de cada terminal
+vector<uint8_t> acoesSemanticas; // AcaoSemantica de cada regra (veja ast.h)
+string arquivoGramatica;
+
+int numTerminais;
+int numNaoTerminais;
+int numSimbolos;
+int tamanhoGramatica;
+
+vector<InfoNaoTerminal> infoNaoTerminais; // Indexado por (não terminal - numTerminais)
 
-const int tamanhoGramatica = gramatica.size();
+inline bool ehTerminal(int simbolo) { return simbolo < numTerminais; }
 
-map<int, InfoNaoTerminal> infoNaoTerminais = {
-    {S, {0, 1}},
-    {E, {1, 4}},
-    {T, {4, 5}}};
+// Arquivo lido quando nenhum é passado com --gramatica
+const char *const GRAMATICA_PADRAO = "gramatica.bnf";
 
-vector<Posicao> estadoInicial = {{0, 1, {EOF}}};
+// Índice de cada estado já criado, pelo seu kernel
+unordered_map<Trecho, int, HashKernel, IgualKernel> estadoDoKernel;
 
-// Armazena todos os estados da gramática
-vector<vector<Posicao>> estados;
+// As tabelas abaixo são indexadas por (não terminal - numTerminais)
 
 // Armazena todos os terminais que podem estar no começo de uma regra que forma um não terminal
-map<int, vector<int>> firstTabela;
+vector<ConjuntoTerminais> firstTabela;
+
+// Diz se o não terminal pode formar a sequência vazia
+vector<bool> naoTerminalAnulavel;
 
 // Armazena todos os terminais que podem seguir um dado não terminal
-map<int, vector<int>> followTabela;
+vector<ConjuntoTerminais> followTabela;
+
+// FIRST de cada sufixo de cada regra: sufixos[r][i] vale para gramatica[r][i..]
+struct Sufixo
+{
+    ConjuntoTerminais primeiros;
+    bool anulavel;
+};
 
-// Armazena a tabela ACTION, que, dado um estado e um terminal, diz qual a próxima ação a ser tomada
-map<int, map<int, string>> actionTabela;
+vector<vector<Sufixo>> sufixos;
+
+// Tabelas ACTION e GOTO, densas e indexadas por [estado][coluna], com as
+// ações codificadas como em parser_lr.h
+
+// Coluna da tabela ACTION (o id do terminal) de cada tipo de token, indexado
+// por tipo + 1, por causa do EOF. A coluna 0 é a dos tokens que não aparecem
+// na gramática, que é sempre erro, e a 1 é a do EOF
+vector<int16_t> colunaTerminal;
+
+const int COLUNA_EOF = 1;
+
+vector<int32_t> actionTabela; // numEstados * numTerminais
+vector<int32_t> gotoTabela;   // numEstados * numNaoTerminais, 0 quando não há desvio
+
+// Tabelas que o PARSE usa: apontam para os vetores acima, quando as tabelas
+// acabaram de ser geradas, ou direto para o arquivo de cache mapeado
+struct TabelasLR
+{
+    int numEstados;
+    int numColunas;
+    const int16_t *colunaTerminal;
+    const int32_t *action;
+    const int32_t *desvio;
+};
+
+TabelasLR tabelas;
+
+// Arquivo onde as tabelas geradas ficam guardadas entre execuções
+const char *const CACHE_TABELAS = "parser.tabelas";
+
+// Conflitos encontrados ao montar a tabela. Fica valendo a primeira ação,
+// exceto que shift ganha de reduce
+struct Conflito
+{
+    int estado;
+    int simbolo;
+    int32_t acaoMantida;
+    int32_t acaoDescartada;
+    bool daFusao = false; // Só existe porque o LALR(1) juntou estados
+};
+
+vector<Conflito> conflitos;
+
+// Threads usadas para criar os estados; com 1, a construção é a serial
+int threadsGeracao = 1;
 
 void printGramatica();
 void printFirst();
 void printFollow();
 void printTabelaEstados();
+void printAST(const ArvoreAST &arvore, const Fonte &fonte);
+string nomeAcao(int32_t acao);
+
+void FIRST();
+void FOLLOW();
+bool lerGramatica(const char *caminho);
+void numerarTerminais();
+void definirAcao(int estado, int simbolo, int32_t acao);
+Trecho criarEstadoFinal(Trecho kernel);
+void criarEstados();
+void criarEstadosParalelo(int numThreads);
+void fundirEstadosLALR();
+int gerarTabelas(bool lalr);
+bool carregarTabelas(const char *caminho, bool lalr);
+void salvarTabelas(const char *caminho, bool lalr);
+uint64_t hashGramatica(bool lalr);
+bool emitirTabelas(const char *caminho, bool lalr);
+
+// Tabelas do PARSE quando elas são geradas ou lidas do cache ao rodar
+struct TabelasEmExecucao
+{
+    static int32_t acao(int estado, int token) { return tabelas.action[estado * tabelas.numColunas + tabelas.colunaTerminal[token + 1]]; }
+    static int desvio(int estado, int naoTerminal) { return tabelas.desvio[estado * numNaoTerminais + naoTerminal - numTerminais]; }
+    static int ladoEsquerdo(int regra) { return gramatica[regra][0]; }
+    static int tamanhoCorpo(int regra) { return gramatica[regra].size() - 1; }
+    static AcaoSemantica acaoSemantica(int regra) { return AcaoSemantica(acoesSemanticas[regra]); }
+};
 
-template <typename T>
-void acumular(T &acumulado, void (*acumulante)(T &));
-void FIRST(map<int, vector<int>> &tabela);
-void FOLLOW(map<int, vector<int>> &tabela);
-int buscaPorCorpo(vector<Posicao> elementos, Posicao pos);
-void criarEstadoFinal(vector<Posicao> &estadoInicial);
-void criarEstados(vector<vector<Posicao>> &estados);
-void PARSE(vector<int> entrada);
+// Entrada usada quando nenhum arquivo é passado
+const string ENTRADA_PADRAO = "inpintepe x = 1 + 2 - 3;";
 
-int estadosCriados;
+// Com -DCEPE_SEM_MAIN, este arquivo pode ser incluído por quem só quer o
+// gerador de tabelas (os benchmarks)
+#ifndef CEPE_SEM_MAIN
+int main(int argc, char *argv[])
+{
+    const char *caminho = nullptr;
+    const char *especificacao = GRAMATICA_PADRAO;
+    const char *cabecalho = nullptr; // Só gera as tabelas em C++ nesse arquivo
+    bool lalr = false;               // Tabelas LALR(1) em vez de LR(1) canônico
+    bool regerar = false;            // Ignora o cache de tabelas
+    bool mostrarAST = false;         // Imprime a árvore sintática
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--lalr") == 0)
+            lalr = true;
+        else if (strcmp(argv[i], "--regerar") == 0)
+            regerar = true;
+        else if (strcmp(argv[i], "--ast") == 0)
+            mostrarAST = true;
+        else if (strcmp(argv[i], "--gerar") == 0 && i + 1 < argc)
+            cabecalho = argv[++i];
+        else if (strcmp(argv[i], "--gramatica") == 0 && i + 1 < argc)
+            especificacao = argv[++i];
+        else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc)
+            threadsGeracao = atoi(argv[++i]);
+        else
+            caminho = argv[i];
+    }
 
-const vector<int> TOKENS = {terminalInt, '+', '-', EOF};
+    // Com as tabelas compiladas, a gramática só é lida para gerar o cabeçalho
+#ifdef CEPE_TABELAS_GERADAS
+    if (cabecalho != nullptr)
+#endif
+        if (!lerGramatica(especificacao))
+            return 1;
+
+    if (cabecalho != nullptr)
+    {
+        gerarTabelas(lalr);
+        if (!conflitos.empty())
+            cerr << "Aviso: a gramática tem " << conflitos.size() << " conflito(s)." << endl;
+
+        return emitirTabelas(cabecalho, lalr) ? 0 : 1;
+    }
+
+    Fonte fonte;
+
+    if (caminho != nullptr)
+    {
+        if (!fonte.abrir(caminho))
+        {
+            cout << "Deu pra abrir não";
+            return 1;
+        }
+    }
+    else
+        fonte.carregarTexto(ENTRADA_PADRAO);
+
+    int estadosLR1 = 0;
+    string origemTabelas; // Vazia quando as tabelas foram geradas agora
+
+#ifdef CEPE_TABELAS_GERADAS
+    numTerminais = NUM_COLUNAS_GERADAS;
+    numNaoTerminais = NUM_NAO_TERMINAIS_GERADOS;
+    nomesSimbolos.assign(begin(nomesSimbolosGerados), end(nomesSimbolosGerados));
+    lalr = LALR_GERADO;
+    (void)regerar; // Não há tabelas para gerar
+#endif
 
-int main()
-{
     auto start = high_resolution_clock::now();
 
     const int ITER = 1;
 
+    // Reaproveitadas entre as iterações
+    PilhaLR pilha;
+    ArvoreAST arvore;
+    ConstrutorAST construtor(arvore);
+    Token erro;
+
     for (int i = 0; i < ITER; i++)
     {
-        firstTabela.clear();
-        followTabela = {{S, {EOF}}};
-        actionTabela.clear();
-        estados = {estadoInicial};
-        estadosCriados = 1;
+        // Código que realiza o parsing, puxando os tokens direto do lexer
+        TabelaSimbolos simbolos;
+        Lexer lexer(fonte, simbolos);
+
+#ifdef CEPE_INSTRUMENTACAO
+        // No parse o lexer só roda junto; aqui ele passa uma vez sozinho para ter o seu tempo
+        {
+            CEPE_FASE(FASE_LEXER);
+            for (Lexer sozinho(fonte, simbolos); sozinho.proximo().tipo != EOF;)
+                CEPE_CONTAR(TOKENS);
+        }
+#endif
+
+#ifdef CEPE_TABELAS_GERADAS
+        tabelas = {NUM_ESTADOS_GERADOS, NUM_COLUNAS_GERADAS, colunaTerminalGerada, actionGerada, gotoGerado};
+        origemTabelas = "tabelas_cepe.h";
+        const bool aceita = PARSE<TabelasCompiladas>(lexer, pilha, erro, construtor);
+#else
+        // Só gera as tabelas se o cache não existir ou for de outra gramática
+        if (!regerar && carregarTabelas(CACHE_TABELAS, lalr))
+            origemTabelas = CACHE_TABELAS;
+        else
+        {
+            estadosLR1 = gerarTabelas(lalr);
+            salvarTabelas(CACHE_TABELAS, lalr);
+        }
 
-        // Código que cria as tabelas necessárias para o parsing
-        acumular<map<int, vector<int>>>(firstTabela, FIRST);
-        acumular<map<int, vector<int>>>(followTabela, FOLLOW);
-        acumular<vector<vector<Posicao>>>(estados, criarEstados);
+        const bool aceita = PARSE<TabelasEmExecucao>(lexer, pilha, erro, construtor);
+#endif
 
-        // Código que realiza o parsing
-        PARSE(TOKENS);
+        if (!aceita)
+        {
+            const LinhaColuna lc = fonte.linhaColuna(erro.inicio);
+            cerr << "Erro de sintaxe na linha " << lc.linha << ", coluna " << lc.coluna << "." << endl;
+            return 1;
+        }
     }
 
+    cout << "Entrada aceita" << endl;
+
     auto end = high_resolution_clock::now();
     duration<double, milli> duration = end - start;
 
     // Código fru fru
 
+    if (mostrarAST)
+        printAST(arvore, fonte);
+
     // printGramatica();
     // printFirst();
     // printFollow();
-    printTabelaEstados();
+    if (origemTabelas.empty())
+        printTabelaEstados();
     cout << endl
-         << "Tempo médio: " << to_string(duration.count() / double(ITER)) << " ms." << endl;
+         << "Tabelas ACTION/GOTO: " << size_t(tabelas.numEstados) * (tabelas.numColunas + numNaoTerminais) * sizeof(int32_t) + (FIM_TOKENS + 1) * sizeof(int16_t)
+         << " bytes (" << tabelas.numEstados << " estados, " << tabelas.numColunas << " colunas de terminais)"
+         << (origemTabelas.empty() ? "" : ", lidas de " + origemTabelas) << endl;
+
+    if (lalr && origemTabelas.empty())
+    {
+        const int daFusao = count_if(conflitos.begin(), conflitos.end(), [](const Conflito &c)
+                                     { return c.daFusao; });
+        cout << "LALR(1): " << estadosLR1 << " estados LR(1) viraram " << estados.size()
+             << ", com " << daFusao << " conflito(s) reduce/reduce novo(s)" << endl;
+    }
+    cout << "Tempo médio: " << to_string(duration.count() / double(ITER)) << " ms." << endl;
 
     return 0;
 }
+#endif
 
 void printGramatica()
 {
     cout << endl
          << "=== GRAMÁTICA ===";
 
-    int lastSimb = 0;
+    int lastSimb = -1;
     for (auto regra : gramatica)
     {
         if (lastSimb != regra[0])
             cout << endl
-                 << simbolosNomes[regra[0]] << ": ";
+                 << nomesSimbolos[regra[0]] << ": ";
         else
             cout << "\n| ";
 
         for (int i = 1; i < regra.size(); i++)
         {
-            cout << simbolosNomes[regra[i]] << " ";
+            cout << nomesSimbolos[regra[i]] << " ";
         }
 
         lastSimb = regra[0];
@@ -174,18 +441,26 @@ void printGramatica()
     cout << endl;
 }
 
+void printConjunto(const ConjuntoTerminais &conjunto)
+{
+    cout << "{";
+    for (int terminal = 1; terminal < numTerminais; terminal++)
+    {
+        if (conjunto[terminal])
+            cout << nomesSimbolos[terminal] << ",";
+    }
+    cout << "}";
+}
+
 void printFirst()
 {
     cout << endl
          << "=== FIRST ===" << endl;
-    for (auto el = firstTabela.begin(); el != firstTabela.end(); el++)
+    for (int k = 0; k < numNaoTerminais; k++)
     {
-        cout << simbolosNomes[el->first] << ": {";
-        for (const int &i : el->second)
-        {
-            cout << simbolosNomes[i] << ",";
-        }
-        cout << "}" << endl;
+        cout << nomesSimbolos[numTerminais + k] << ": ";
+        printConjunto(firstTabela[k]);
+        cout << (naoTerminalAnulavel[k] ? " (anulável)" : "") << endl;
     }
 }
 
@@ -193,14 +468,11 @@ void printFollow()
 {
     cout << endl
          << "=== FOLLOW ===" << endl;
-    for (auto el = followTabela.begin(); el != followTabela.end(); el++)
+    for (int k = 0; k < numNaoTerminais; k++)
     {
-        cout << simbolosNomes[el->first] << ": {";
-        for (const int &i : el->second)
-        {
-            cout << simbolosNomes[i] << ",";
-        }
-        cout << "}" << endl;
+        cout << nomesSimbolos[numTerminais + k] << ": ";
+        printConjunto(followTabela[k]);
+        cout << endl;
     }
 }
 
@@ -210,347 +482,1574 @@ void printTabelaEstados()
          << "=== TABELA DE ESTADOS ===" << endl;
     for (int i = 0; i < estados.size(); i++)
     {
-        vector<Posicao> estado = estados[i];
-        map<int, string> actionAtual = actionTabela[i];
-
         cout << endl
              << "== ESTADO " << to_string(i) << " == " << endl;
-        for (Posicao pos : estado)
+        for (uint32_t k = estados[i].inicio; k < estados[i].inicio + estados[i].tamanho; k++)
         {
-            vector<int> regra = gramatica[pos.regra];
-            cout << simbolosNomes[regra[0]] << " -> ";
+            const Posicao pos = arenaEstados[k];
+            const vector<int> &regra = gramatica[pos.regra()];
+            cout << nomesSimbolos[regra[0]] << " -> ";
 
             // Regra
             for (int i = 1; i < regra.size(); i++)
             {
-                if (i == pos.posicao)
+                if (i == pos.posicao())
                     cout << ". ";
 
-                cout << simbolosNomes[regra[i]] << " ";
+                cout << nomesSimbolos[regra[i]] << " ";
             }
 
-            if (pos.posicao == regra.size())
+            if (pos.posicao() == regra.size())
                 cout << ". ";
 
             // Lookaheads
-            cout << "{";
-
-            for (int i = 0; i < pos.lookaheads.size(); i++)
-            {
-                cout << simbolosNomes[pos.lookaheads[i]] << ",";
-            }
-            cout << "}" << endl;
+            printConjunto(conjuntos[pos.lookaheads]);
+            cout << endl;
         }
-        for (auto acao = actionAtual.begin(); acao != actionAtual.end(); acao++)
+        for (int terminal = 1; terminal < numTerminais; terminal++)
         {
-            cout << simbolosNomes[acao->first] << ": " << acao->second << endl;
+            const int32_t acao = actionTabela[i * numTerminais + terminal];
+            if (tipoAcao(acao) != ERRO)
+                cout << nomesSimbolos[terminal] << ": " << nomeAcao(acao) << endl;
+        }
+        for (int k = 0; k < numNaoTerminais; k++)
+        {
+            const int32_t destino = gotoTabela[i * numNaoTerminais + k];
+            if (destino != 0)
+                cout << nomesSimbolos[numTerminais + k] << ": " << destino << endl;
         }
     }
+
+    for (Conflito c : conflitos)
+        cout << endl
+             << "Conflito no estado " << c.estado << " com " << nomesSimbolos[c.simbolo] << ": "
+             << nomeAcao(c.acaoMantida) << " / " << nomeAcao(c.acaoDescartada)
+             << (c.daFusao ? " (criado pela fusão LALR)" : "");
+    if (!conflitos.empty())
+        cout << endl;
 }
 
-// Utiliza a propriedade de "transitive closure" das funções abaixo
-template <typename T>
-void acumular(T &acumulado, void (*acumulante)(T &))
+// Um nó por linha, indentado pela profundidade. As folhas mostram o token e
+// o lexema (e os identificadores, o id na tabela de símbolos); os outros
+// nós, o não terminal e a regra que os formou
+void printAST(const ArvoreAST &arvore, const Fonte &fonte)
 {
-    T temp;
+    cout << endl
+         << "=== ÁRVORE SINTÁTICA (" << arvore.nos.size() << " nós) ===" << endl;
+
+    // Sem recursão: expressões longas dão árvores fundas
+    vector<pair<uint32_t, int>> pendentes = {{arvore.raiz, 0}};
 
-    do
+    while (!pendentes.empty())
     {
-        temp = acumulado;
-        acumulante(acumulado);
-    } while (temp != acumulado);
+        const auto [no, profundidade] = pendentes.back();
+        pendentes.pop_back();
+
+        const NoAST &n = arvore.nos[no];
+        cout << string(2 * profundidade, ' ');
+
+        if (arvore.folha(no))
+        {
+            const int tipo = arvore.tipoFolha(no);
+            cout << nomesTokens[tipo] << ": " << fonte.lexema({tipo, n.inicio, n.tamanho, -1});
+            if (n.regra == FOLHA_ID)
+                cout << " (#" << n.simbolo << ")";
+            cout << endl;
+        }
+        else
+            cout << nomesSimbolos[n.simbolo] << (n.regra == LISTA ? " (lista)" : " (r" + to_string(n.regra) + ")") << endl;
+
+        for (uint32_t k = arvore.numFilhos(no); k > 0; k--)
+            pendentes.push_back({arvore.primeiroFilho(no)[k - 1], profundidade + 1});
+    }
 }
 
-// Retorna um conjunto de símbolos terminais que podem estar
-// no começo de dado símbolo não terminal
-void FIRST(map<int, vector<int>> &tabela)
+string nomeAcao(int32_t acao)
 {
-    for (auto regra : gramatica)
+    switch (tipoAcao(acao))
+    {
+    case SHIFT:
+        return "s" + to_string(alvoAcao(acao));
+    case REDUCE:
+        return "r" + to_string(alvoAcao(acao));
+    case ACEITAR:
+        return "acc";
+    default:
+        return "erro";
+    }
+}
+
+/*
+    FIRST, FOLLOW e os modelos de fechamento são pontos fixos. Em vez de
+    repetir a passada inteira até nada mudar, cada um mantém uma fila de
+    trabalho: quando o conjunto de um símbolo cresce, só o que depende dele
+    volta para a fila
+*/
+
+// Calcula FIRST e naoTerminalAnulavel de cada não terminal e depois o FIRST de cada
+// sufixo de regra, que é o que o fechamento usa
+void FIRST()
+{
+    CEPE_FASE(FASE_FIRST);
+
+    firstTabela.assign(numNaoTerminais, ConjuntoTerminais());
+    naoTerminalAnulavel.assign(numNaoTerminais, false);
+
+    // Regras em cujo corpo cada não terminal aparece: são as que podem
+    // mudar quando o FIRST dele muda
+    vector<vector<int>> usos(numNaoTerminais);
+    for (int r = 0; r < tamanhoGramatica; r++)
+        for (int i = 1; i < gramatica[r].size(); i++)
+        {
+            const int simbolo = gramatica[r][i] - numTerminais;
+            if (simbolo >= 0 && (usos[simbolo].empty() || usos[simbolo].back() != r))
+                usos[simbolo].push_back(r);
+        }
+
+    vector<int> fila;
+    vector<bool> naFila(tamanhoGramatica, true);
+    for (int r = tamanhoGramatica - 1; r >= 0; r--)
+        fila.push_back(r);
+
+    while (!fila.empty())
     {
-        // Vetor auxiliar (foi o jeito que achei de manter o conjunto exclusivo)
-        vector<int> temp;
+        const int r = fila.back();
+        fila.pop_back();
+        naFila[r] = false;
 
-        // O não terminal em questão
-        const int naoTerminal = regra[0];
+        const vector<int> &regra = gramatica[r];
 
-        const int primeiroSimbolo = regra[1];
+        // FIRST do corpo: junta os símbolos até o primeiro que não é anulável
+        ConjuntoTerminais primeiros;
+        bool corpoAnulavel = true;
 
-        // Se for terminal, adicionar ao conjunto
-        if (primeiroSimbolo < 512)
+        for (int i = 1; i < regra.size() && corpoAnulavel; i++)
         {
-            temp.push_back(primeiroSimbolo);
+            if (ehTerminal(regra[i]))
+            {
+                primeiros.set(regra[i]);
+                corpoAnulavel = false;
+            }
+            else
+            {
+                primeiros |= firstTabela[regra[i] - numTerminais];
+                corpoAnulavel = naoTerminalAnulavel[regra[i] - numTerminais];
+            }
         }
-        // Se for não terminal e for diferente do não terminal passado,
-        // chamar FIRST(primeiroSimbolo) e adicionar o resultado ao conjunto
-        else if (primeiroSimbolo != naoTerminal)
+
+        const int naoTerminal = regra[0] - numTerminais;
+        const ConjuntoTerminais novo = firstTabela[naoTerminal] | primeiros;
+
+        if (novo == firstTabela[naoTerminal] && (naoTerminalAnulavel[naoTerminal] || !corpoAnulavel))
+            continue;
+
+        firstTabela[naoTerminal] = novo;
+        naoTerminalAnulavel[naoTerminal] = naoTerminalAnulavel[naoTerminal] || corpoAnulavel;
+
+        for (int uso : usos[naoTerminal])
         {
-            const vector<int> terminaisSimbolo = tabela[primeiroSimbolo];
-            temp.insert(temp.end(), terminaisSimbolo.begin(), terminaisSimbolo.end());
+            if (!naFila[uso])
+            {
+                naFila[uso] = true;
+                fila.push_back(uso);
+            }
         }
+    }
+
+    // Sufixos, de trás para frente
+    sufixos.assign(tamanhoGramatica, {});
+    for (int r = 0; r < tamanhoGramatica; r++)
+    {
+        const vector<int> &regra = gramatica[r];
+        sufixos[r].resize(regra.size() + 1);
+        sufixos[r][regra.size()] = {ConjuntoTerminais(), true};
+
+        for (int i = regra.size() - 1; i >= 1; i--)
+        {
+            const Sufixo &resto = sufixos[r][i + 1];
 
-        // Atualizar tabela
-        tabela[naoTerminal] = temp;
+            if (ehTerminal(regra[i]))
+                sufixos[r][i] = {ConjuntoTerminais().set(regra[i]), false};
+            else
+            {
+                const int simbolo = regra[i] - numTerminais;
+                sufixos[r][i] = {firstTabela[simbolo] | (naoTerminalAnulavel[simbolo] ? resto.primeiros : ConjuntoTerminais()),
+                                 naoTerminalAnulavel[simbolo] && resto.anulavel};
+            }
+        }
     }
 }
 
 // Retorna um conjunto de símbolos terminais que podem seguir
 // dado símbolo não terminal
-void FOLLOW(map<int, vector<int>> &tabela)
+void FOLLOW()
 {
-    map<int, vector<int>> temp = {{S, {EOF}}};
+    CEPE_FASE(FASE_FOLLOW);
 
-    for (auto regra : gramatica)
+    followTabela.assign(numNaoTerminais, ConjuntoTerminais());
+    followTabela[0].set(COLUNA_EOF); // O não terminal inicial
+
+    // A -> ... X β com β anulável: tudo que segue A também segue X
+    vector<vector<int>> herdeiros(numNaoTerminais);
+
+    for (int r = 0; r < tamanhoGramatica; r++)
     {
-        // Seleciona cada símbolo da regra atual, pulando o não terminal gerado a partir da regra
+        const vector<int> &regra = gramatica[r];
+        const int naoTerminal = regra[0] - numTerminais;
+
         for (int i = 1; i < regra.size(); i++)
         {
-            const int simbolo = regra[i];
-
-            // Se o símbolo for terminal, pode pular
-            if (simbolo < 512)
+            if (ehTerminal(regra[i]))
                 continue;
 
-            // Verifica se o próximo símbolo seria o final da regra
-            if (i + 1 == regra.size())
-            {
-                temp[simbolo] = tabela[regra[0]];
-                continue;
-            }
+            const int simbolo = regra[i] - numTerminais;
+            followTabela[simbolo] |= sufixos[r][i + 1].primeiros;
 
-            // Extraí o próximo símbolo
-            const int proxSimbolo = regra[i + 1];
+            if (sufixos[r][i + 1].anulavel && simbolo != naoTerminal)
+                herdeiros[naoTerminal].push_back(simbolo);
+        }
+    }
 
-            // Se for terminal, adicionar ao conjunto
-            if (proxSimbolo < 512)
-            {
-                temp[simbolo].push_back(proxSimbolo);
-            }
-            // Se for não terminal, adiciona FIRST(proxSimbolo) ao conjunto de terminais
-            else
+    vector<int> fila;
+    vector<bool> naFila(numNaoTerminais, true);
+    for (int simbolo = numNaoTerminais - 1; simbolo >= 0; simbolo--)
+        fila.push_back(simbolo);
+
+    while (!fila.empty())
+    {
+        const int naoTerminal = fila.back();
+        fila.pop_back();
+        naFila[naoTerminal] = false;
+
+        for (int herdeiro : herdeiros[naoTerminal])
+        {
+            const ConjuntoTerminais novo = followTabela[herdeiro] | followTabela[naoTerminal];
+            if (novo == followTabela[herdeiro])
+                continue;
+
+            followTabela[herdeiro] = novo;
+            if (!naFila[herdeiro])
             {
-                const vector<int> terminaisSimbolo = firstTabela[proxSimbolo];
-                temp[simbolo].insert(tabela[simbolo].end(), terminaisSimbolo.begin(), terminaisSimbolo.end());
+                naFila[herdeiro] = true;
+                fila.push_back(herdeiro);
             }
         }
     }
-
-    // Atualiza a tabela
-    tabela = temp;
 }
 
-int buscaPorCorpo(vector<Posicao> elementos, Posicao pos)
+// Tokens que a gramática pode citar pelo nome do enumerador
+const map<string, int> tokensPorNome = {
+#define X(tk, nome, palavra) {#tk, Tokens::tk},
+    TOKENS_CEPE(X)
+#undef X
+};
+
+// Tipo do token escrito entre aspas na gramática, ou -2 se nenhum token se escreve assim
+int tokenDoLiteral(string_view literal)
 {
-    int len = elementos.size();
+    if (literal.size() == 1)
+        return (unsigned char)literal[0];
 
-    for (int i = 0; i < len; i++)
-    {
-        Posicao posAtual = elementos[i];
-        if (posAtual.regra == pos.regra && posAtual.posicao == pos.posicao)
-            return i;
-    }
+    const int palavra = classificarPalavra(literal.data(), literal.size());
+    if (palavra != Tokens::ID)
+        return palavra;
+
+    for (const auto &[token, nome] : nomesTokens)
+        if (nome == literal)
+            return token;
 
-    return len;
+    return -2;
 }
 
-// Cria todas as possíveis posições para um estado dado um estado inicial
-void criarEstadoFinal(vector<Posicao> &estadoInicial)
-{
-    // E -> E . + T {+, -, EOF}
-    // Posicao {naoTerminal = E, Regra = {E + T}, posicao = 2, lookaheads = {+, -, EOF}}
-    vector<Posicao> temp = estadoInicial;
-    for (Posicao pos : estadoInicial)
-    {
-        vector<int> regra = gramatica[pos.regra];
+/*
+    Lê a especificação da gramática, num BNF simples:
 
-        // Chegamos no final da regra
-        if (pos.posicao == regra.size())
-            continue;
+        # comentário até o fim da linha
+        nome : simbolo simbolo ... | outra alternativa | ;
 
-        const int proxSimbolo = regra[pos.posicao];
+    Cada regra termina em ';' e as alternativas são separadas por '|'; uma
+    alternativa sem símbolos é a produção vazia. Entre aspas (simples ou
+    duplas) vem um terminal: um caractere só é o próprio caractere, e um
+    texto maior é uma palavra-chave ('sepe') ou o nome de um token em
+    nomesTokens ('+='). Um nome sem aspas é o enumerador de um token (ID,
+    INT_NUM...) ou, se não for, um não terminal, que precisa ter regras no
+    arquivo. O primeiro não terminal definido é o inicial.
 
-        // O próximo símbolo é um terminal
-        if (proxSimbolo < 512)
-            continue;
+    "%lista nome nome ... ;" marca não terminais que são listas recursivas à
+    esquerda (X : X item | primeiro item): na árvore eles viram um nó só,
+    com todos os itens como filhos, em vez de uma cadeia de nós.
 
-        // A partir daqui, o próximo símbolo é não terminal
+    Os terminais são numerados em ordem crescente de tipo de token e os não
+    terminais na ordem em que aparecem no arquivo
+*/
+bool lerGramatica(const char *caminho)
+{
+    Fonte arquivo;
+    if (!arquivo.abrir(caminho))
+    {
+        cerr << "Não deu pra abrir a gramática " << caminho << "." << endl;
+        return false;
+    }
 
-        // Construir o conjunto de lookahead antes do loop é mais eficiente
-        vector<int> lookaheads;
+    const string_view texto(arquivo.inicio(), arquivo.bytes());
+    size_t p = 0;
+    int linha = 1;
 
-        // Se o elemento após o próximo não existir
-        if (pos.posicao + 1 == regra.size())
-            lookaheads = followTabela[regra[0]];
-        // Se o o elemento após o próximo for um terminal
-        else if (regra[pos.posicao + 1] < 512)
-            lookaheads = {regra[pos.posicao + 1]};
-        // Por fim, se o elemento após o próximo for um não terminal
-        else
-            lookaheads = firstTabela[regra[pos.posicao + 1]];
+    auto erro = [&](const string &mensagem)
+    {
+        cerr << caminho << ":" << linha << ": " << mensagem << endl;
+        return false;
+    };
 
-        // Criando uma variável para as novas posições
-        Posicao novaPos;
-        novaPos.posicao = 1;
-        novaPos.lookaheads = lookaheads;
+    // Próxima palavra do arquivo: tipo 'n' para um nome, '"' para um texto
+    // entre aspas, o próprio caractere para ':', '|', ';' e '%' e 0 no fim
+    struct PalavraLida
+    {
+        char tipo;
+        string_view texto;
+    };
 
-        InfoNaoTerminal naoTerminalAtual = infoNaoTerminais[proxSimbolo];
+    auto ehLetraDeNome = [](char c)
+    {
+        return isalnum((unsigned char)c) || c == '_' || (unsigned char)c >= 0x80;
+    };
 
-        for (int i = naoTerminalAtual.indexComeco; i < naoTerminalAtual.indexFim; i++)
+    auto proxima = [&]() -> PalavraLida
+    {
+        while (p < texto.size())
         {
-            novaPos.regra = i;
+            if (texto[p] == '\n')
+                linha++;
+
+            if (texto[p] == '#')
+                while (p < texto.size() && texto[p] != '\n')
+                    p++;
+            else if (isspace((unsigned char)texto[p]))
+                p++;
+            else
+                break;
+        }
 
-            int index = buscaPorCorpo(temp, novaPos);
+        if (p == texto.size())
+            return {0, {}};
 
-            if (index == temp.size())
-                temp.push_back(novaPos);
-            else
-            {
-                vector<int> lookahdeasPos = temp[index].lookaheads;
+        const size_t inicio = p;
 
-                for (int i = 0; i < lookaheads.size(); i++)
-                {
-                    if (find(lookahdeasPos.begin(), lookahdeasPos.end(), lookaheads[i]) == lookahdeasPos.end())
-                        lookahdeasPos.push_back(lookaheads[i]);
-                }
+        if (texto[p] == '\'' || texto[p] == '"')
+        {
+            const size_t fim = texto.find(texto[p], p + 1);
+            if (fim == string_view::npos || texto.substr(p, fim - p).find('\n') != string_view::npos)
+                return {'?', texto.substr(p, 1)};
 
-                temp[index].lookaheads = lookahdeasPos;
-            }
+            p = fim + 1;
+            return {'"', texto.substr(inicio + 1, fim - inicio - 1)};
         }
-    }
-
-    estadoInicial = temp;
-}
 
-// Cria todos os estados a partir de um estado inicial
-void criarEstados(vector<vector<Posicao>> &estados)
-{
-    vector<vector<Posicao>> temp = estados;
+        if (ehLetraDeNome(texto[p]))
+        {
+            while (p < texto.size() && ehLetraDeNome(texto[p]))
+                p++;
+            return {'n', texto.substr(inicio, p - inicio)};
+        }
 
-    // Armazena quantos estados foram criados na última iteração
-    // static int n = 1;
-    const int fimTemp = temp.size();
-    const int comecoLoop = fimTemp - estadosCriados;
+        p++;
+        return {strchr(":|;%", texto[inicio]) != nullptr ? texto[inicio] : '?', texto.substr(inicio, 1)};
+    };
 
-    for (int i = comecoLoop; i < fimTemp; i++)
+    // Regras como estão no arquivo: os terminais guardam o tipo do token e
+    // os não terminais o índice na ordem de aparição
+    struct SimboloLido
     {
-        vector<Posicao> estadoAtual = temp[i];
+        bool terminal;
+        int valor;
+    };
 
-        // Atualizar o estado
-        acumular<vector<Posicao>>(estadoAtual, criarEstadoFinal);
-        temp[i] = estadoAtual;
-
-        vector<vector<Posicao>> novosEstados;
-        map<int, int> simboloParaEstado;
+    struct RegraLida
+    {
+        int naoTerminal;
+        int linha;
+        vector<SimboloLido> corpo;
+    };
+
+    vector<RegraLida> regras;
+    map<string_view, int> naoTerminalDoNome;
+    vector<string_view> nomesNaoTerminais;
+    vector<int> linhaDoNaoTerminal; // Onde cada não terminal apareceu primeiro
+    vector<bool> definido;
+    vector<pair<string_view, int>> listas; // Marcados com %lista, com a linha
+
+    auto naoTerminal = [&](string_view nome)
+    {
+        auto [existente, novo] = naoTerminalDoNome.try_emplace(nome, nomesNaoTerminais.size());
+        if (novo)
+        {
+            nomesNaoTerminais.push_back(nome);
+            linhaDoNaoTerminal.push_back(linha);
+            definido.push_back(false);
+        }
+        return existente->second;
+    };
 
-        for (Posicao pos : estadoAtual)
+    for (PalavraLida palavra = proxima(); palavra.tipo != 0; palavra = proxima())
+    {
+        if (palavra.tipo == '%')
         {
-            const vector<int> regra = gramatica[pos.regra];
+            const PalavraLida diretiva = proxima();
+            if (diretiva.tipo != 'n' || diretiva.texto != "lista")
+                return erro("diretiva desconhecida %" + string(diretiva.texto));
 
-            if (pos.posicao == regra.size())
+            for (PalavraLida lista = proxima(); lista.tipo != ';'; lista = proxima())
             {
-                for (int lk : pos.lookaheads)
-                {
-                    string action = "r" + to_string(pos.regra);
-                    if (actionTabela[i][lk] == action)
-                    {
-                        string previousAction(1, actionTabela[i][lk][0]);
-                        actionTabela[i][lk] = "c" + previousAction + "r";
-                    }
-                    else
-                        actionTabela[i][lk] = action;
-                }
-                continue;
+                if (lista.tipo != 'n')
+                    return erro("esperava o nome de um não terminal em %lista");
+                listas.push_back({lista.texto, linha});
             }
+            continue;
+        }
+
+        const string nome(palavra.texto);
+
+        if (palavra.tipo != 'n')
+            return erro("esperava o nome de um não terminal e veio '" + nome + "'");
+        if (tokensPorNome.count(nome) > 0)
+            return erro(nome + " é um token e não pode ter regras");
+
+        const int definicao = naoTerminal(palavra.texto);
+        definido[definicao] = true;
 
-            const int proxSimbolo = regra[pos.posicao];
-            Posicao novaPos = pos;
-            novaPos.posicao++;
+        if (proxima().tipo != ':')
+            return erro("esperava ':' depois de " + nome);
 
-            // Se o próximo símbolo da regra atual ainda não levar a nenhum novo estado
-            if (simboloParaEstado.count(proxSimbolo) == 0)
+        regras.push_back({definicao, linha, {}});
+
+        for (PalavraLida simbolo = proxima(); simbolo.tipo != ';'; simbolo = proxima())
+        {
+            if (simbolo.tipo == '|')
+                regras.push_back({definicao, linha, {}});
+            else if (simbolo.tipo == 'n')
             {
-                const int novosLen = novosEstados.size();
-                string action = "s" + to_string(fimTemp + novosLen);
-                simboloParaEstado[proxSimbolo] = novosLen;
-                if (actionTabela[i][proxSimbolo] == action)
-                    actionTabela[i][proxSimbolo] = "cs" + string(1, actionTabela[i][proxSimbolo][0]);
+                auto token = tokensPorNome.find(string(simbolo.texto));
+                if (token != tokensPorNome.end())
+                    regras.back().corpo.push_back({true, token->second});
                 else
-                    actionTabela[i][proxSimbolo] = action;
-                novosEstados.push_back({});
+                    regras.back().corpo.push_back({false, naoTerminal(simbolo.texto)});
             }
+            else if (simbolo.tipo == '"')
+            {
+                const int token = simbolo.texto.empty() ? -2 : tokenDoLiteral(simbolo.texto);
+                if (token == -2)
+                    return erro("nenhum token se escreve '" + string(simbolo.texto) + "'");
 
-            novosEstados[simboloParaEstado[proxSimbolo]].push_back(novaPos);
+                regras.back().corpo.push_back({true, token});
+            }
+            else if (simbolo.tipo == 0)
+                return erro("as regras de " + nome + " não terminam com ';'");
+            else
+                return erro("símbolo inválido '" + string(simbolo.texto) + "' nas regras de " + nome);
         }
-
-        temp.insert(temp.end(), novosEstados.begin(), novosEstados.end());
     }
-    // A quantidade de estados criada é igual a diferença entre o
-    // tamanho final e inicial do vetor de estados
-    estadosCriados = temp.size() - fimTemp;
-
-    estados = temp;
-}
 
-void PARSE(vector<int> entrada)
-{
-    /*
-        Preciso de:
-        - Fila de estados
-        - Fila de caracters
-    */
+    if (regras.empty())
+        return erro("a gramática não tem nenhuma regra");
 
-    stack<int> estados;
-    stack<int> simbolos;
-    stack<int> tokens;
+    for (size_t k = 0; k < nomesNaoTerminais.size(); k++)
+    {
+        if (!definido[k])
+        {
+            linha = linhaDoNaoTerminal[k];
+            return erro(string(nomesNaoTerminais[k]) + " é usado mas não tem regras");
+        }
+    }
 
-    for (int i = entrada.size(); i >= 0; i--)
+    // Terminais: a coluna 0 (tokens fora da gramática), o EOF e os tokens
+    // usados, em ordem crescente
+    tokenDoTerminal = {-2, EOF};
+    for (const RegraLida &regra : regras)
+        for (SimboloLido simbolo : regra.corpo)
+            if (simbolo.terminal)
+                tokenDoTerminal.push_back(simbolo.valor);
+
+    sort(tokenDoTerminal.begin() + 2, tokenDoTerminal.end());
+    tokenDoTerminal.erase(unique(tokenDoTerminal.begin() + 2, tokenDoTerminal.end()), tokenDoTerminal.end());
+
+    numTerminais = tokenDoTerminal.size();
+    if (numTerminais > MAX_TERMINAIS)
+        return erro("a gramática tem terminais demais: aumente MAX_TERMINAIS");
+
+    // Não terminais: o inicial aumentado e depois os do arquivo
+    numNaoTerminais = nomesNaoTerminais.size() + 1;
+    numSimbolos = numTerminais + numNaoTerminais;
+
+    nomesSimbolos.assign(numSimbolos, "");
+    nomesSimbolos[0] = "?";
+    nomesSimbolos[COLUNA_EOF] = "EOF";
+    for (int terminal = 2; terminal < numTerminais; terminal++)
     {
-        tokens.push(entrada[i]);
+        const int token = tokenDoTerminal[terminal];
+        nomesSimbolos[terminal] = token < 256 ? string(1, char(token)) : nomesTokens[token];
     }
 
-    // Inicializar as filas;
-    estados.push(0);  // Começamos no estado 0
-    simbolos.push(S); // Começamos com o símbolo S
+    nomesSimbolos[numTerminais] = string(nomesNaoTerminais[0]) + "'";
+    for (size_t k = 0; k < nomesNaoTerminais.size(); k++)
+        nomesSimbolos[numTerminais + 1 + k] = nomesNaoTerminais[k];
+
+    // Regras, agrupadas pelo lado esquerdo na ordem do arquivo
+    stable_sort(regras.begin(), regras.end(), [](const RegraLida &a, const RegraLida &b)
+                { return a.naoTerminal < b.naoTerminal; });
 
-    while (true)
+    auto idDoSimbolo = [&](SimboloLido simbolo)
     {
-        int tokenAtual = tokens.top();
-        int estadoAtual = estados.top();
-        string acaoAtual = actionTabela[estadoAtual][tokenAtual];
+        if (simbolo.terminal)
+            return int(lower_bound(tokenDoTerminal.begin() + 2, tokenDoTerminal.end(), simbolo.valor) - tokenDoTerminal.begin());
 
-        if (acaoAtual.empty())
-        {
-            cerr << "Erro de sintaxe." << endl;
-            exit(1);
-        }
+        return numTerminais + 1 + simbolo.valor;
+    };
 
-        if (acaoAtual == "r0")
+    gramatica = {{numTerminais, numTerminais + 1}};
+    infoNaoTerminais.assign(numNaoTerminais, {0, 0});
+    infoNaoTerminais[0] = {0, 1};
+
+    for (const RegraLida &regra : regras)
+    {
+        // A posição dentro da regra ocupa 8 bits do corpo das posições
+        if (regra.corpo.size() > 254)
         {
-            cout << "Entrada aceita" << endl;
-            return;
+            linha = regra.linha;
+            return erro("regra com símbolos demais");
         }
 
-        // Ação de shift
-        if (acaoAtual[0] == 's')
-        {
-            int proxEstado = acaoAtual[1] - '0';
+        const int ladoEsquerdo = numTerminais + 1 + regra.naoTerminal;
+        InfoNaoTerminal &info = infoNaoTerminais[ladoEsquerdo - numTerminais];
+        if (info.indexFim == 0)
+            info.indexComeco = gramatica.size();
+        info.indexFim = gramatica.size() + 1;
 
-            estados.push(proxEstado);
-            simbolos.push(tokenAtual);
-            tokens.pop();
-            continue;
-        }
+        gramatica.push_back({ladoEsquerdo});
+        for (SimboloLido simbolo : regra.corpo)
+            gramatica.back().push_back(idDoSimbolo(simbolo));
+    }
+
+    tamanhoGramatica = gramatica.size();
 
-        // Ação de reduce
-        vector<int> regraReduce = gramatica[acaoAtual[1] - '0'];
-        int simboloReduce = regraReduce[0];
-        int tamanhoReduce = regraReduce.size() - 1;
+    // Ações semânticas: as regras das listas abrem ou estendem a lista, as
+    // unitárias repassam o valor do filho e o resto cria um nó
+    acoesSemanticas.assign(tamanhoGramatica, CRIAR_NO);
+    for (int r = 0; r < tamanhoGramatica; r++)
+    {
+        const vector<int> &regra = gramatica[r];
+        if (regra.size() == 2 && (!ehTerminal(regra[1]) || tokenComValor(tokenDoTerminal[regra[1]])))
+            acoesSemanticas[r] = REPASSAR;
+    }
+
+    for (auto [nome, linhaLista] : listas)
+    {
+        linha = linhaLista;
 
-        for (int i = 0; i < tamanhoReduce; i++)
+        auto definicao = naoTerminalDoNome.find(nome);
+        if (definicao == naoTerminalDoNome.end())
+            return erro("%lista de " + string(nome) + ", que não tem regras");
+
+        const int lista = numTerminais + 1 + definicao->second;
+        const InfoNaoTerminal info = infoNaoTerminais[lista - numTerminais];
+
+        for (int r = info.indexComeco; r < info.indexFim; r++)
         {
-            simbolos.pop();
-            estados.pop();
-        }
+            const vector<int> &regra = gramatica[r];
+            const bool estende = regra.size() > 1 && regra[1] == lista;
 
-        tokens.push(simboloReduce);
-    }
+            // A lista só pode aparecer no começo das próprias regras
+            if (find(regra.begin() + (estende ? 2 : 1), regra.end(), lista) != regra.end())
+                return erro(string(nome) + " não é uma lista recursiva à esquerda");
+
+            acoesSemanticas[r] = estende ? ESTENDER_LISTA : ABRIR_LISTA;
+        }
+    }
+
+    arquivoGramatica = caminho;
+    return true;
+}
+
+// Liga cada tipo de token à coluna do seu terminal; os tokens que não
+// aparecem na gramática ficam na coluna 0
+void numerarTerminais()
+{
+    colunaTerminal.assign(FIM_TOKENS + 1, 0);
+    for (int terminal = 1; terminal < numTerminais; terminal++)
+        colunaTerminal[tokenDoTerminal[terminal] + 1] = terminal;
+}
+
+// Preenche ACTION (terminais) ou GOTO (não terminais) para o estado, aumentando
+// as tabelas quando o estado ainda não tem linha
+void definirAcao(int estado, int simbolo, int32_t acao)
+{
+    if (actionTabela.size() < size_t(estado + 1) * numTerminais)
+    {
+        actionTabela.resize(size_t(estado + 1) * numTerminais, 0);
+        gotoTabela.resize(size_t(estado + 1) * numNaoTerminais, 0);
+    }
+
+    if (!ehTerminal(simbolo))
+    {
+        // Desvios só vêm de shifts, e cada símbolo leva a um único estado
+        gotoTabela[estado * numNaoTerminais + simbolo - numTerminais] = alvoAcao(acao);
+        return;
+    }
+
+    int32_t &atual = actionTabela[estado * numTerminais + simbolo];
+
+    if (atual == ERRO || atual == acao)
+    {
+        atual = acao;
+        return;
+    }
+
+    if (tipoAcao(acao) == SHIFT)
+    {
+        conflitos.push_back({estado, simbolo, acao, atual});
+        atual = acao;
+    }
+    else
+        conflitos.push_back({estado, simbolo, atual, acao});
+}
+
+/*
+    Rascunhos reaproveitados de um estado para o outro, para que fechar e
+    expandir estados não aloque memória depois que eles atingem o tamanho máximo
+*/
+
+// Posição com os lookaheads ainda abertos, enquanto o fechamento os acumula
+struct PosicaoAberta
+{
+    uint32_t corpo;
+    ConjuntoTerminais lookaheads;
+};
+
+/*
+    Modelos de fechamento: para cada não terminal A, os não terminais B cujas
+    regras entram no fechamento quando A vem logo depois do ponto, com os
+    lookaheads que B ganha lá dentro (os espontâneos) e se os lookaheads
+    que A recebe também chegam até B (propaga). Fechar A com lookaheads L
+    dá às regras de cada B os espontâneos, mais L quando propaga
+*/
+struct ItemModelo
+{
+    int naoTerminal;
+    ConjuntoTerminais espontaneos;
+    bool propaga;
+};
+
+vector<vector<ItemModelo>> modelosFechamento; // Indexado por (não terminal - numTerminais)
+
+/*
+    Plano de fechamento de um núcleo (as posições de um kernel, sem os
+    lookaheads): todas as posições do estado fechado, ordenadas pelo corpo,
+    cada uma com os seus lookaheads espontâneos e as posições do kernel
+    cujos lookaheads passam para ela. Os estados LR(1) com o mesmo núcleo só
+    diferem nos lookaheads do kernel, então o plano é feito uma vez por
+    núcleo e fechar um estado vira juntar conjuntos
+*/
+struct PosicaoPlano
+{
+    uint32_t corpo;
+    ConjuntoTerminais espontaneos;
+    uint32_t inicioOrigens; // Trecho de PlanoFechamento::origens
+    uint32_t fimOrigens;
+};
+
+struct PlanoFechamento
+{
+    vector<PosicaoPlano> posicoes;
+    vector<uint32_t> origens; // Índices no kernel
+};
+
+struct HashNucleo
+{
+    size_t operator()(const vector<uint32_t> &nucleo) const
+    {
+        size_t h = nucleo.size();
+
+        for (uint32_t corpo : nucleo)
+            h = h * 1000003 ^ corpo;
+
+        return h;
+    }
+};
+
+PlanoFechamento criarPlano(const vector<uint32_t> &nucleo);
+
+// Planos já feitos, pelo núcleo. Threads diferentes podem pedir planos ao
+// mesmo tempo; um plano que falta é feito fora da trava
+class MemoFechamento
+{
+public:
+    const PlanoFechamento &plano(const vector<uint32_t> &nucleo)
+    {
+        {
+            lock_guard<mutex> trava(mtx);
+            auto existente = planos.find(nucleo);
+            if (existente != planos.end())
+                return existente->second;
+        }
+
+        PlanoFechamento novo = criarPlano(nucleo);
+
+        // Se outra thread fez o mesmo plano nesse meio tempo, fica o dela
+        lock_guard<mutex> trava(mtx);
+        return planos.try_emplace(nucleo, move(novo)).first->second;
+    }
+
+    void limpar() { planos.clear(); }
+
+private:
+    mutex mtx;
+    unordered_map<vector<uint32_t>, PlanoFechamento, HashNucleo> planos;
+};
+
+MemoFechamento memoFechamento;
+
+// Um por thread na construção paralela
+struct RascunhoFechamento
+{
+    vector<PosicaoAberta> fechamento;
+    vector<uint32_t> nucleo;
+};
+
+RascunhoFechamento rascunho;
+
+// Shifts de um estado: o grupo (um por símbolo) e a posição já avançada
+vector<pair<int, Posicao>> transicoes;
+vector<int> grupoDoSimbolo; // Indexado pelo símbolo, -1 quando ainda não tem grupo
+vector<int> simboloDoGrupo;
+
+// Calcula o modelo de fechamento de cada não terminal. Cada B -> C ... do
+// modelo leva C para o modelo com FIRST(...) e, se ... for anulável, com o
+// que B recebe
+void criarModelosFechamento()
+{
+    modelosFechamento.assign(numNaoTerminais, {});
+
+    vector<int> indiceNoModelo;
+    vector<int> fila;
+
+    for (int a = 0; a < numNaoTerminais; a++)
+    {
+        vector<ItemModelo> &modelo = modelosFechamento[a];
+
+        indiceNoModelo.assign(numNaoTerminais, -1);
+        indiceNoModelo[a] = 0;
+        modelo.push_back({numTerminais + a, ConjuntoTerminais(), true});
+        fila = {0};
+
+        while (!fila.empty())
+        {
+            const int k = fila.back();
+            fila.pop_back();
+
+            const InfoNaoTerminal &info = infoNaoTerminais[modelo[k].naoTerminal - numTerminais];
+
+            for (int r = info.indexComeco; r < info.indexFim; r++)
+            {
+                const vector<int> &regra = gramatica[r];
+                if (regra.size() < 2 || ehTerminal(regra[1]))
+                    continue;
+
+                const Sufixo &resto = sufixos[r][2];
+                const ConjuntoTerminais espontaneos = resto.anulavel ? resto.primeiros | modelo[k].espontaneos : resto.primeiros;
+                const bool propaga = resto.anulavel && modelo[k].propaga;
+
+                int &indice = indiceNoModelo[regra[1] - numTerminais];
+
+                if (indice < 0)
+                {
+                    indice = modelo.size();
+                    modelo.push_back({regra[1], espontaneos, propaga});
+                }
+                else if ((modelo[indice].espontaneos | espontaneos) != modelo[indice].espontaneos || (propaga && !modelo[indice].propaga))
+                {
+                    modelo[indice].espontaneos |= espontaneos;
+                    modelo[indice].propaga = modelo[indice].propaga || propaga;
+                }
+                else
+                    continue;
+
+                fila.push_back(indice);
+            }
+        }
+    }
+}
+
+// Junta os modelos dos não terminais que vêm depois do ponto no núcleo.
+// Para E -> E + . T, entram as regras de T com os lookaheads FIRST(β L),
+// onde β é o que vem depois de T (aqui vazio, então o próprio L do kernel)
+PlanoFechamento criarPlano(const vector<uint32_t> &nucleo)
+{
+    CEPE_CONTAR(PLANOS_FECHAMENTO);
+
+    struct Entrada
+    {
+        uint32_t corpo;
+        ConjuntoTerminais espontaneos;
+        vector<uint32_t> origens;
+    };
+
+    // As posições do kernel e, depois, as regras de cada não terminal alcançado
+    vector<Entrada> entradas;
+    vector<int> entradaDoNaoTerminal(numNaoTerminais, -1);
+    vector<int> alcancados;
+
+    for (uint32_t k = 0; k < nucleo.size(); k++)
+        entradas.push_back({nucleo[k], ConjuntoTerminais(), {k}});
+
+    vector<Entrada> porNaoTerminal;
+
+    for (uint32_t k = 0; k < nucleo.size(); k++)
+    {
+        const int regraPos = nucleo[k] >> 8, posicao = nucleo[k] & 0xff;
+        const vector<int> &regra = gramatica[regraPos];
+
+        if (posicao == int(regra.size()) || ehTerminal(regra[posicao]))
+            continue;
+
+        const Sufixo &resto = sufixos[regraPos][posicao + 1];
+
+        for (const ItemModelo &item : modelosFechamento[regra[posicao] - numTerminais])
+        {
+            int &indice = entradaDoNaoTerminal[item.naoTerminal - numTerminais];
+            if (indice < 0)
+            {
+                indice = porNaoTerminal.size();
+                porNaoTerminal.push_back({0, ConjuntoTerminais(), {}});
+                alcancados.push_back(item.naoTerminal);
+            }
+
+            Entrada &entrada = porNaoTerminal[indice];
+            entrada.espontaneos |= item.espontaneos;
+
+            if (item.propaga)
+            {
+                entrada.espontaneos |= resto.primeiros;
+                if (resto.anulavel && (entrada.origens.empty() || entrada.origens.back() != k))
+                    entrada.origens.push_back(k);
+            }
+        }
+    }
+
+    // Todas as regras de um não terminal alcançado começam com os mesmos
+    // lookaheads. Só o kernel do estado inicial tem posições no começo de
+    // uma regra, e elas se juntam às que vêm do fechamento
+    for (size_t i = 0; i < alcancados.size(); i++)
+    {
+        const InfoNaoTerminal &info = infoNaoTerminais[alcancados[i] - numTerminais];
+
+        for (int r = info.indexComeco; r < info.indexFim; r++)
+        {
+            const uint32_t corpo = codificarCorpo(r, 1);
+            auto noKernel = lower_bound(nucleo.begin(), nucleo.end(), corpo);
+
+            if (noKernel == nucleo.end() || *noKernel != corpo)
+            {
+                entradas.push_back({corpo, porNaoTerminal[i].espontaneos, porNaoTerminal[i].origens});
+                continue;
+            }
+
+            Entrada &entrada = entradas[noKernel - nucleo.begin()];
+            entrada.espontaneos |= porNaoTerminal[i].espontaneos;
+            entrada.origens.insert(entrada.origens.end(), porNaoTerminal[i].origens.begin(), porNaoTerminal[i].origens.end());
+            sort(entrada.origens.begin(), entrada.origens.end());
+            entrada.origens.erase(unique(entrada.origens.begin(), entrada.origens.end()), entrada.origens.end());
+        }
+    }
+
+    sort(entradas.begin(), entradas.end(), [](const Entrada &a, const Entrada &b)
+         { return a.corpo < b.corpo; });
+
+    PlanoFechamento plano;
+    for (const Entrada &entrada : entradas)
+    {
+        const uint32_t inicio = plano.origens.size();
+        plano.origens.insert(plano.origens.end(), entrada.origens.begin(), entrada.origens.end());
+        plano.posicoes.push_back({entrada.corpo, entrada.espontaneos, inicio, uint32_t(plano.origens.size())});
+    }
+
+    return plano;
+}
+
+// Cria todas as possíveis posições para um estado dado o seu kernel, deixando
+// o estado em r.fechamento, ordenado pelo corpo: os lookaheads de cada
+// posição são os espontâneos do plano do núcleo mais os das posições do
+// kernel que passam para ela. Só lê as estruturas globais (e o memo, que
+// tem trava), então threads diferentes podem fechar estados ao mesmo tempo
+void fecharKernel(Trecho kernel, RascunhoFechamento &r)
+{
+    CEPE_FASE(FASE_FECHAMENTO);
+
+    const Posicao *posicoes = arenaKernels.data() + kernel.inicio;
+
+    r.nucleo.clear();
+    for (uint32_t k = 0; k < kernel.tamanho; k++)
+        r.nucleo.push_back(posicoes[k].corpo);
+
+    const PlanoFechamento &plano = memoFechamento.plano(r.nucleo);
+
+    r.fechamento.clear();
+    for (const PosicaoPlano &pos : plano.posicoes)
+    {
+        ConjuntoTerminais lookaheads = pos.espontaneos;
+        for (uint32_t o = pos.inicioOrigens; o < pos.fimOrigens; o++)
+            lookaheads |= conjuntos[posicoes[plano.origens[o]].lookaheads];
+
+        r.fechamento.push_back({pos.corpo, lookaheads});
+    }
+
+    CEPE_SOMAR(ITERACOES_FECHAMENTO, plano.posicoes.size());
+}
+
+// Guarda o estado fechado na arena, com os lookaheads internados
+Trecho guardarEstado(const vector<PosicaoAberta> &fechamento)
+{
+    const Trecho estado = {uint32_t(arenaEstados.size()), uint32_t(fechamento.size())};
+    CEPE_SOMAR(POSICOES_CRIADAS, fechamento.size());
+
+    for (const PosicaoAberta &pos : fechamento)
+        arenaEstados.push_back({pos.corpo, internarConjunto(pos.lookaheads)});
+
+    return estado;
+}
+
+Trecho criarEstadoFinal(Trecho kernel)
+{
+    fecharKernel(kernel, rascunho);
+    return guardarEstado(rascunho.fechamento);
+}
+
+// Cria todos os estados a partir do estado inicial. Os kernels servem de
+// fila: cada estado novo entra no fim e é fechado e expandido quando o
+// laço chega nele
+void criarEstados()
+{
+    if (grupoDoSimbolo.size() != size_t(numSimbolos))
+        grupoDoSimbolo.assign(numSimbolos, -1);
+
+    for (int i = 0; i < int(kernels.size()); i++)
+    {
+        const Trecho estado = criarEstadoFinal(kernels[i]);
+        estados.push_back(estado);
+
+        CEPE_FASE(FASE_GOTO);
+
+        transicoes.clear();
+        simboloDoGrupo.clear();
+
+        for (uint32_t k = estado.inicio; k < estado.inicio + estado.tamanho; k++)
+        {
+            const Posicao pos = arenaEstados[k];
+            const vector<int> &regra = gramatica[pos.regra()];
+
+            if (pos.posicao() == regra.size())
+            {
+                // Reduzir pela regra inicial no fim da entrada é aceitar
+                const ConjuntoTerminais &lookaheads = conjuntos[pos.lookaheads];
+                for (int terminal = 1; terminal < numTerminais; terminal++)
+                    if (lookaheads[terminal])
+                        definirAcao(i, terminal, pos.regra() == 0 && terminal == COLUNA_EOF ? codificarAcao(ACEITAR, 0) : codificarAcao(REDUCE, pos.regra()));
+                continue;
+            }
+
+            // Os grupos são numerados na ordem em que os símbolos aparecem
+            const int proxSimbolo = regra[pos.posicao()];
+            if (grupoDoSimbolo[proxSimbolo] < 0)
+            {
+                grupoDoSimbolo[proxSimbolo] = simboloDoGrupo.size();
+                simboloDoGrupo.push_back(proxSimbolo);
+            }
+
+            transicoes.push_back({grupoDoSimbolo[proxSimbolo], {pos.corpo + 1, pos.lookaheads}});
+        }
+
+        // Dentro de cada grupo as posições continuam ordenadas pelo corpo,
+        // então cada grupo já é um kernel pronto
+        stable_sort(transicoes.begin(), transicoes.end(), [](const pair<int, Posicao> &a, const pair<int, Posicao> &b)
+                    { return a.first < b.first; });
+
+        // Reaproveita os estados que já existem; os outros entram no fim da fila
+        for (size_t k = 0; k < transicoes.size();)
+        {
+            const int grupo = transicoes[k].first;
+            const Trecho kernel = {uint32_t(arenaKernels.size()), 0};
+
+            for (; k < transicoes.size() && transicoes[k].first == grupo; k++)
+                arenaKernels.push_back(transicoes[k].second);
+
+            const Trecho candidato = {kernel.inicio, uint32_t(arenaKernels.size() - kernel.inicio)};
+
+            auto [existente, novo] = estadoDoKernel.try_emplace(candidato, kernels.size());
+            if (novo)
+                kernels.push_back(candidato);
+            else
+                arenaKernels.resize(candidato.inicio);
+
+            definirAcao(i, simboloDoGrupo[grupo], codificarAcao(SHIFT, existente->second));
+        }
+
+        for (int simbolo : simboloDoGrupo)
+            grupoDoSimbolo[simbolo] = -1;
+    }
+}
+
+/*
+    Construção paralela dos estados, nível por nível da busca em largura: os
+    estados criados pelo nível anterior são fechados e expandidos ao mesmo
+    tempo, cada thread com os seus rascunhos, e os kernels que eles geram
+    são procurados numa tabela concorrente. Depois, numa passada só, em
+    ordem, os kernels novos ganham número, os lookaheads são internados e as
+    ações entram na tabela. Essa passada percorre os estados e os grupos na
+    mesma ordem de criarEstados(), então a numeração, os conjuntos e as
+    tabelas saem idênticos aos da construção serial
+*/
+
+struct HashKernelAberto
+{
+    size_t operator()(const vector<PosicaoAberta> &kernel) const
+    {
+        size_t h = kernel.size();
+
+        for (const PosicaoAberta &pos : kernel)
+            h = (h * 1000003 ^ pos.corpo) * 31 + hash<ConjuntoTerminais>()(pos.lookaheads);
+
+        return h;
+    }
+};
+
+struct IgualKernelAberto
+{
+    bool operator()(const vector<PosicaoAberta> &a, const vector<PosicaoAberta> &b) const
+    {
+        return equal(a.begin(), a.end(), b.begin(), b.end(), [](const PosicaoAberta &pa, const PosicaoAberta &pb)
+                     { return pa.corpo == pb.corpo && pa.lookaheads == pb.lookaheads; });
+    }
+};
+
+// Kernel e o número do seu estado (-1 até a passada em ordem numerá-lo)
+typedef pair<const vector<PosicaoAberta>, int> EntradaKernel;
+
+/*
+    Tabela de kernels dividida em fatias, cada uma com a sua trava, para que
+    threads procurando kernels diferentes quase nunca esperem umas pelas
+    outras. Os kernels ainda têm os lookaheads abertos porque internar só
+    acontece na passada em ordem
+*/
+class TabelaKernels
+{
+public:
+    // Entrada do kernel, criada se ele ainda não existe. O ponteiro vale
+    // enquanto a tabela existir
+    EntradaKernel *inserir(const vector<PosicaoAberta> &kernel)
+    {
+        const size_t h = HashKernelAberto()(kernel);
+        Fatia &fatia = fatias[(h >> 7 ^ h) % NUM_FATIAS];
+
+        lock_guard<mutex> trava(fatia.mtx);
+        return &*fatia.estadoDoKernel.try_emplace(kernel, -1).first;
+    }
+
+private:
+    static const int NUM_FATIAS = 64;
+
+    struct alignas(64) Fatia
+    {
+        mutex mtx;
+        unordered_map<vector<PosicaoAberta>, int, HashKernelAberto, IgualKernelAberto> estadoDoKernel;
+    };
+
+    Fatia fatias[NUM_FATIAS];
+};
+
+// Rascunhos de cada thread
+struct alignas(64) RascunhoExpansao
+{
+    RascunhoFechamento fechar;
+    vector<pair<int, PosicaoAberta>> transicoes;
+    vector<int> grupoDoSimbolo;
+    vector<int> simboloDoGrupo;
+    vector<PosicaoAberta> kernel;
+};
+
+// O que a parte paralela descobre de cada estado do nível
+struct EstadoExpandido
+{
+    vector<PosicaoAberta> fechamento;
+    vector<pair<int, EntradaKernel *>> shifts; // Símbolo e kernel de destino, na ordem dos grupos
+};
+
+// Fecha o estado e procura os kernels de todos os seus shifts na tabela
+void expandirEstado(Trecho kernel, RascunhoExpansao &r, TabelaKernels &tabela, EstadoExpandido &resultado)
+{
+    fecharKernel(kernel, r.fechar);
+
+    CEPE_FASE(FASE_GOTO);
+
+    resultado.fechamento = r.fechar.fechamento;
+    resultado.shifts.clear();
+
+    if (r.grupoDoSimbolo.size() != size_t(numSimbolos))
+        r.grupoDoSimbolo.assign(numSimbolos, -1);
+
+    r.transicoes.clear();
+    r.simboloDoGrupo.clear();
+
+    for (const PosicaoAberta &pos : resultado.fechamento)
+    {
+        const vector<int> &regra = gramatica[pos.corpo >> 8];
+        if ((pos.corpo & 0xff) == regra.size())
+            continue;
+
+        const int proxSimbolo = regra[pos.corpo & 0xff];
+        if (r.grupoDoSimbolo[proxSimbolo] < 0)
+        {
+            r.grupoDoSimbolo[proxSimbolo] = r.simboloDoGrupo.size();
+            r.simboloDoGrupo.push_back(proxSimbolo);
+        }
+
+        r.transicoes.push_back({r.grupoDoSimbolo[proxSimbolo], {pos.corpo + 1, pos.lookaheads}});
+    }
+
+    stable_sort(r.transicoes.begin(), r.transicoes.end(), [](const pair<int, PosicaoAberta> &a, const pair<int, PosicaoAberta> &b)
+                { return a.first < b.first; });
+
+    for (size_t k = 0; k < r.transicoes.size();)
+    {
+        const int grupo = r.transicoes[k].first;
+
+        r.kernel.clear();
+        for (; k < r.transicoes.size() && r.transicoes[k].first == grupo; k++)
+            r.kernel.push_back(r.transicoes[k].second);
+
+        resultado.shifts.push_back({r.simboloDoGrupo[grupo], tabela.inserir(r.kernel)});
+    }
+
+    for (int simbolo : r.simboloDoGrupo)
+        r.grupoDoSimbolo[simbolo] = -1;
+}
+
+// Guarda o estado expandido, numerando os kernels novos na ordem em que aparecem
+void registrarEstado(int i, const EstadoExpandido &expandido)
+{
+    CEPE_FASE(FASE_GOTO);
+
+    const Trecho estado = guardarEstado(expandido.fechamento);
+    estados.push_back(estado);
+
+    for (uint32_t k = estado.inicio; k < estado.inicio + estado.tamanho; k++)
+    {
+        const Posicao pos = arenaEstados[k];
+        if (pos.posicao() != int(gramatica[pos.regra()].size()))
+            continue;
+
+        const ConjuntoTerminais &lookaheads = conjuntos[pos.lookaheads];
+        for (int terminal = 1; terminal < numTerminais; terminal++)
+            if (lookaheads[terminal])
+                definirAcao(i, terminal, pos.regra() == 0 && terminal == COLUNA_EOF ? codificarAcao(ACEITAR, 0) : codificarAcao(REDUCE, pos.regra()));
+    }
+
+    for (auto [simbolo, entrada] : expandido.shifts)
+    {
+        if (entrada->second < 0)
+        {
+            entrada->second = kernels.size();
+            kernels.push_back({uint32_t(arenaKernels.size()), uint32_t(entrada->first.size())});
+
+            // Os lookaheads já foram internados junto com este estado
+            for (const PosicaoAberta &pos : entrada->first)
+                arenaKernels.push_back({pos.corpo, internarConjunto(pos.lookaheads)});
+        }
+
+        definirAcao(i, simbolo, codificarAcao(SHIFT, entrada->second));
+    }
+}
+
+// Mesmo resultado de criarEstados(), usando numThreads threads
+void criarEstadosParalelo(int numThreads)
+{
+    PoolThreads pool(numThreads);
+    vector<RascunhoExpansao> rascunhos(pool.tamanho());
+    vector<EstadoExpandido> nivel;
+    TabelaKernels tabela;
+
+    vector<PosicaoAberta> inicial;
+    for (uint32_t k = kernels[0].inicio; k < kernels[0].inicio + kernels[0].tamanho; k++)
+        inicial.push_back({arenaKernels[k].corpo, conjuntos[arenaKernels[k].lookaheads]});
+    tabela.inserir(inicial)->second = 0;
+
+    // Durante a parte paralela só se lê kernels, arenaKernels e conjuntos;
+    // eles só crescem na passada em ordem
+    for (int inicio = 0; inicio < int(kernels.size());)
+    {
+        const int fim = kernels.size();
+        if (nivel.size() < size_t(fim - inicio))
+            nivel.resize(fim - inicio);
+
+        pool.paraCadaRoubando(fim - inicio, [&](int k, int thread)
+                              { expandirEstado(kernels[inicio + k], rascunhos[thread], tabela, nivel[k]); });
+
+        for (int i = inicio; i < fim; i++)
+            registrarEstado(i, nivel[i - inicio]);
+
+        inicio = fim;
+    }
+}
+
+/*
+    Transforma a coleção LR(1) canônica em LALR(1): estados com o mesmo
+    núcleo (as mesmas posições, ignorando os lookaheads) viram um estado só,
+    com a união dos lookaheads. As linhas de ACTION/GOTO dos estados fundidos
+    são juntadas; o que não coincidir é um conflito que o LR(1) não tinha, e
+    só pode ser reduce/reduce
+*/
+void fundirEstadosLALR()
+{
+    CEPE_FASE(FASE_LALR);
+
+    // 1. Numera os núcleos na ordem em que aparecem, então o estado 0 continua 0.
+    // Os estados estão ordenados pelo corpo, então o núcleo é a sequência de corpos
+    map<vector<uint32_t>, int> estadoDoNucleo;
+    vector<int> novoEstado(estados.size());
+    vector<Posicao> arenaFundida;
+    vector<Trecho> fundidos;
+    vector<uint32_t> nucleo;
+
+    for (int i = 0; i < estados.size(); i++)
+    {
+        const Trecho estado = estados[i];
+
+        nucleo.clear();
+        for (uint32_t k = estado.inicio; k < estado.inicio + estado.tamanho; k++)
+            nucleo.push_back(arenaEstados[k].corpo);
+
+        auto [existente, novo] = estadoDoNucleo.try_emplace(nucleo, fundidos.size());
+        novoEstado[i] = existente->second;
+
+        if (novo)
+        {
+            fundidos.push_back({uint32_t(arenaFundida.size()), estado.tamanho});
+            arenaFundida.insert(arenaFundida.end(), arenaEstados.begin() + estado.inicio, arenaEstados.begin() + estado.inicio + estado.tamanho);
+            continue;
+        }
+
+        // Junta os lookaheads de cada posição; as posições estão na mesma ordem
+        const Trecho destino = fundidos[existente->second];
+        for (uint32_t k = 0; k < estado.tamanho; k++)
+        {
+            uint32_t &lookaheads = arenaFundida[destino.inicio + k].lookaheads;
+            lookaheads = internarConjunto(conjuntos[lookaheads] | conjuntos[arenaEstados[estado.inicio + k].lookaheads]);
+        }
+    }
+
+    // 2. Refaz as tabelas com os estados renumerados
+    const vector<int32_t> actionLR1 = move(actionTabela);
+    const vector<int32_t> gotoLR1 = move(gotoTabela);
+    const vector<Conflito> conflitosLR1 = move(conflitos);
+
+    actionTabela.assign(fundidos.size() * numTerminais, 0);
+    gotoTabela.assign(fundidos.size() * numNaoTerminais, 0);
+    conflitos.clear();
+
+    auto renumerar = [&](int32_t acao)
+    {
+        return tipoAcao(acao) == SHIFT ? codificarAcao(SHIFT, novoEstado[alvoAcao(acao)]) : acao;
+    };
+
+    for (Conflito c : conflitosLR1)
+    {
+        c = {novoEstado[c.estado], c.simbolo, renumerar(c.acaoMantida), renumerar(c.acaoDescartada)};
+        if (none_of(conflitos.begin(), conflitos.end(), [&](const Conflito &o)
+                    { return o.estado == c.estado && o.simbolo == c.simbolo && o.acaoMantida == c.acaoMantida && o.acaoDescartada == c.acaoDescartada; }))
+            conflitos.push_back(c);
+    }
+
+    const int conflitosAntes = conflitos.size();
+
+    for (int i = 0; i < estados.size(); i++)
+    {
+        for (int terminal = 1; terminal < numTerminais; terminal++)
+        {
+            const int32_t acao = actionLR1[i * numTerminais + terminal];
+            if (acao != ERRO)
+                definirAcao(novoEstado[i], terminal, renumerar(acao));
+        }
+
+        for (int k = 0; k < numNaoTerminais; k++)
+        {
+            const int32_t destino = gotoLR1[i * numNaoTerminais + k];
+            if (destino != 0)
+                gotoTabela[novoEstado[i] * numNaoTerminais + k] = novoEstado[destino];
+        }
+    }
+
+    for (int k = conflitosAntes; k < conflitos.size(); k++)
+        conflitos[k].daFusao = true;
+
+    arenaEstados = move(arenaFundida);
+    estados = move(fundidos);
+}
+
+// Cria as tabelas ACTION/GOTO a partir da gramática e retorna quantos
+// estados a coleção LR(1) canônica teve
+int gerarTabelas(bool lalr)
+{
+    actionTabela.clear();
+    gotoTabela.clear();
+    conflitos.clear();
+
+    numerarTerminais();
+    FIRST();
+    FOLLOW();
+    criarModelosFechamento();
+    memoFechamento.limpar();
+
+    // O estado inicial tem só inicio' -> . <não terminal inicial> {EOF}
+    conjuntos.clear();
+    indiceConjunto.clear();
+    arenaKernels = {{codificarCorpo(0, 1), internarConjunto(ConjuntoTerminais().set(COLUNA_EOF))}};
+    kernels = {{0, 1}};
+    arenaEstados.clear();
+    estados.clear();
+    estadoDoKernel = {{kernels[0], 0}};
+    if (threadsGeracao > 1)
+        criarEstadosParalelo(threadsGeracao);
+    else
+        criarEstados();
+
+    const int estadosLR1 = estados.size();
+    CEPE_SOMAR(ESTADOS, estadosLR1);
+
+    if (lalr)
+        fundirEstadosLALR();
+
+    // Garante uma linha para cada estado, mesmo os que não têm nenhuma ação
+    actionTabela.resize(estados.size() * numTerminais, 0);
+    gotoTabela.resize(estados.size() * numNaoTerminais, 0);
+
+    tabelas = {int(estados.size()), numTerminais, colunaTerminal.data(), actionTabela.data(), gotoTabela.data()};
+    CEPE_SOMAR(CONFLITOS, conflitos.size());
+    return estadosLR1;
+}
+
+/*
+    Cache das tabelas em disco. Gerar as tabelas é o que mais custa antes do
+    parsing e a gramática quase nunca muda, então elas são gravadas num
+    arquivo binário que as próximas execuções mapeiam na memória e usam sem
+    copiar. O arquivo guarda um hash da gramática (e do modo LR(1)/LALR(1));
+    se não bater, as tabelas são geradas de novo e o arquivo é reescrito.
+
+    Formato, na ordem da máquina que gravou:
+        CabecalhoCache
+        int16 colunaTerminal[numTokens], completado até um múltiplo de 4 bytes
+        int32 action[numEstados * numColunas]
+        int32 goto[numEstados * numNaoTerminais]
+*/
+const uint32_t VERSAO_CACHE = 2;
+const char ASSINATURA_CACHE[8] = {'C', 'e', 'P', 'e', 'L', 'R', 0, 0};
+
+struct CabecalhoCache
+{
+    char assinatura[8];
+    uint32_t versao;
+    uint32_t numEstados;
+    uint64_t hashGramatica;
+    uint32_t numColunas;
+    uint32_t numNaoTerminais;
+    uint32_t numTokens; // Entradas de colunaTerminal
+    uint32_t reservado;
+};
+
+// Mantém o arquivo de cache mapeado enquanto as tabelas estiverem em uso
+Fonte arquivoTabelas;
+
+// FNV-1a de tudo que muda as tabelas
+uint64_t hashGramatica(bool lalr)
+{
+    uint64_t h = 14695981039346656037ull;
+    auto misturar = [&](int64_t valor)
+    {
+        for (int i = 0; i < 8; i++)
+        {
+            h ^= uint64_t(valor >> (8 * i)) & 0xff;
+            h *= 1099511628211ull;
+        }
+    };
+
+    misturar(lalr);
+    misturar(FIM_TOKENS);
+    misturar(numTerminais);
+    misturar(numNaoTerminais);
+
+    for (int token : tokenDoTerminal)
+        misturar(token);
+
+    for (const vector<int> &regra : gramatica)
+    {
+        misturar(regra.size());
+        for (int simbolo : regra)
+            misturar(simbolo);
+    }
+
+    return h;
+}
+
+size_t bytesColunas(size_t numTokens) { return (numTokens * sizeof(int16_t) + 3) / 4 * 4; }
+
+bool carregarTabelas(const char *caminho, bool lalr)
+{
+    if (!arquivoTabelas.abrir(caminho))
+        return false;
+
+    const char *dados = arquivoTabelas.inicio();
+    const size_t tamanho = arquivoTabelas.bytes();
+
+    CabecalhoCache cab;
+    if (tamanho < sizeof(cab))
+        return false;
+    memcpy(&cab, dados, sizeof(cab));
+
+    if (memcmp(cab.assinatura, ASSINATURA_CACHE, sizeof(cab.assinatura)) != 0 || cab.versao != VERSAO_CACHE ||
+        cab.hashGramatica != hashGramatica(lalr) || cab.numNaoTerminais != numNaoTerminais ||
+        cab.numTokens != FIM_TOKENS + 1 || cab.numEstados == 0 || cab.numColunas != uint32_t(numTerminais))
+    {
+        arquivoTabelas.fechar();
+        return false;
+    }
+
+    const size_t celulasAction = size_t(cab.numEstados) * cab.numColunas;
+    const size_t celulasGoto = size_t(cab.numEstados) * numNaoTerminais;
+    if (tamanho != sizeof(cab) + bytesColunas(cab.numTokens) + (celulasAction + celulasGoto) * sizeof(int32_t))
+    {
+        arquivoTabelas.fechar();
+        return false;
+    }
+
+    const int16_t *colunas = (const int16_t *)(dados + sizeof(cab));
+    const int32_t *action = (const int32_t *)(dados + sizeof(cab) + bytesColunas(cab.numTokens));
+    const int32_t *desvio = action + celulasAction;
+
+    // Um arquivo corrompido não pode levar o PARSE para fora das tabelas
+    bool valido = true;
+    for (size_t k = 0; k < cab.numTokens; k++)
+        valido &= colunas[k] >= 0 && colunas[k] < int(cab.numColunas);
+    for (size_t k = 0; k < celulasAction; k++)
+        valido &= tipoAcao(action[k]) != SHIFT || uint32_t(alvoAcao(action[k])) < cab.numEstados;
+    for (size_t k = 0; k < celulasAction; k++)
+        valido &= tipoAcao(action[k]) != REDUCE || uint32_t(alvoAcao(action[k])) < tamanhoGramatica;
+    for (size_t k = 0; k < celulasGoto; k++)
+        valido &= uint32_t(desvio[k]) < cab.numEstados;
+
+    if (!valido)
+    {
+        arquivoTabelas.fechar();
+        return false;
+    }
+
+    tabelas = {int(cab.numEstados), int(cab.numColunas), colunas, action, desvio};
+    return true;
+}
+
+// Grava as tabelas atuais. Escreve num arquivo temporário e troca no fim,
+// então uma gravação interrompida nunca deixa um cache pela metade
+void salvarTabelas(const char *caminho, bool lalr)
+{
+    CEPE_FASE(FASE_EMISSAO);
+
+    arquivoTabelas.fechar();
+
+    CabecalhoCache cab = {};
+    memcpy(cab.assinatura, ASSINATURA_CACHE, sizeof(cab.assinatura));
+    cab.versao = VERSAO_CACHE;
+    cab.numEstados = tabelas.numEstados;
+    cab.hashGramatica = hashGramatica(lalr);
+    cab.numColunas = tabelas.numColunas;
+    cab.numNaoTerminais = numNaoTerminais;
+    cab.numTokens = FIM_TOKENS + 1;
+
+    const string temporario = string(caminho) + ".tmp";
+    {
+        ofstream saida(temporario, ios::binary | ios::trunc);
+
+        vector<char> colunas(bytesColunas(cab.numTokens), 0);
+        memcpy(colunas.data(), tabelas.colunaTerminal, cab.numTokens * sizeof(int16_t));
+
+        saida.write((const char *)&cab, sizeof(cab));
+        saida.write(colunas.data(), colunas.size());
+        saida.write((const char *)tabelas.action, size_t(cab.numEstados) * cab.numColunas * sizeof(int32_t));
+        saida.write((const char *)tabelas.desvio, size_t(cab.numEstados) * numNaoTerminais * sizeof(int32_t));
+
+        if (!saida)
+        {
+            cerr << "Não deu pra gravar o cache de tabelas em " << caminho << "." << endl;
+            remove(temporario.c_str());
+            return;
+        }
+    }
+
+#ifdef _WIN32
+    remove(caminho); // rename não substitui arquivos no Windows
+#endif
+    if (rename(temporario.c_str(), caminho) != 0)
+        remove(temporario.c_str());
+}
+
+// Escreve um cabeçalho C++ com as tabelas atuais como arrays constexpr,
+// mais o que o PARSE precisa saber de cada regra
+bool emitirTabelas(const char *caminho, bool lalr)
+{
+    CEPE_FASE(FASE_EMISSAO);
+
+    ofstream saida(caminho, ios::trunc);
+    if (!saida)
+    {
+        cerr << "Não deu pra criar " << caminho << "." << endl;
+        return false;
+    }
+
+    // Escreve os valores de um array, 16 por linha
+    auto escreverArray = [&](const char *declaracao, size_t n, auto valor)
+    {
+        saida << declaracao << " = {";
+        for (size_t k = 0; k < n; k++)
+            saida << (k % 16 == 0 ? "\n    " : " ") << valor(k) << (k + 1 < n ? "," : "");
+        saida << "};\n\n";
+    };
+
+    saida << "/*\n"
+          << "    Tabelas " << (lalr ? "LALR(1)" : "LR(1)") << " da gramática do CePe.\n"
+          << "    Gerado por \"parser --gerar\" a partir de " << arquivoGramatica << "; não edite.\n"
+          << "*/\n\n"
+          << "#ifndef CEPE_TABELAS_GERADAS_H\n"
+          << "#define CEPE_TABELAS_GERADAS_H\n\n"
+          << "#include <cstdint>\n\n"
+          << "constexpr uint64_t HASH_TOKENS_GERADO = " << hashTokens() << "ull; // Conferido em parser_lr.h\n"
+          << "constexpr bool LALR_GERADO = " << (lalr ? "true" : "false") << ";\n"
+          << "constexpr int NUM_ESTADOS_GERADOS = " << tabelas.numEstados << ";\n"
+          << "constexpr int NUM_COLUNAS_GERADAS = " << tabelas.numColunas << "; // Também o primeiro não terminal\n"
+          << "constexpr int NUM_NAO_TERMINAIS_GERADOS = " << numNaoTerminais << ";\n\n";
+
+    escreverArray("constexpr int16_t colunaTerminalGerada[]", FIM_TOKENS + 1, [](size_t k)
+                  { return tabelas.colunaTerminal[k]; });
+    escreverArray("constexpr int32_t actionGerada[]", size_t(tabelas.numEstados) * tabelas.numColunas, [](size_t k)
+                  { return tabelas.action[k]; });
+    escreverArray("constexpr int32_t gotoGerado[]", size_t(tabelas.numEstados) * numNaoTerminais, [](size_t k)
+                  { return tabelas.desvio[k]; });
+    escreverArray("constexpr int16_t ladoEsquerdoGerado[]", tamanhoGramatica, [](size_t k)
+                  { return gramatica[k][0]; });
+    escreverArray("constexpr uint8_t tamanhoCorpoGerado[]", tamanhoGramatica, [](size_t k)
+                  { return gramatica[k].size() - 1; });
+    escreverArray("constexpr uint8_t acaoSemanticaGerada[]", tamanhoGramatica, [](size_t k)
+                  { return int(acoesSemanticas[k]); });
+    escreverArray("constexpr const char *nomesSimbolosGerados[]", numSimbolos, [](size_t k)
+                  {
+                      string nome = "\"";
+                      for (char c : nomesSimbolos[k])
+                          nome += c == '"' || c == '\\' ? string("\\") + c : string(1, c);
+                      return nome + "\""; });
+
+    saida << "#endif\n";
+    return bool(saida);
 }
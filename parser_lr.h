@@ -0,0 +1,186 @@
+/*
+    Driver LR do CePe: codificação das ações, pilha do parser e o laço
+    do PARSE, que só lê as tabelas. Fica separado de parser.cpp para que
+    quem já tem as tabelas prontas (o parser gerado, os benchmarks) não
+    precise do gerador
+*/
+
+#ifndef CEPE_PARSER_LR_H
+#define CEPE_PARSER_LR_H
+
+#include <vector>
+#include <cstdint>
+#include "lexer.h"
+#include "instrumentacao.h"
+
+using namespace std;
+
+/*
+    Cada ação da tabela ACTION é um único inteiro: os 2 bits de baixo dizem
+    o tipo da ação e o resto é o alvo (estado do shift ou regra do reduce).
+    Assim cada passo do parser é uma leitura na tabela, sem busca nem
+    conversão de string
+*/
+enum TipoAcao
+{
+    ERRO = 0,
+    SHIFT,
+    REDUCE,
+    ACEITAR
+};
+
+inline int32_t codificarAcao(TipoAcao tipo, int alvo) { return alvo << 2 | tipo; }
+inline TipoAcao tipoAcao(int32_t acao) { return TipoAcao(acao & 3); }
+inline int alvoAcao(int32_t acao) { return acao >> 2; }
+
+/*
+    O que fazer com os valores do corpo de uma regra quando ela é reduzida
+    (veja ast.h). Sai da gramática: as listas são os não terminais marcados
+    com %lista em gramatica.bnf
+*/
+enum AcaoSemantica
+{
+    CRIAR_NO = 0,   // Nó com os filhos que têm valor
+    REPASSAR,       // Regra unitária: o valor do único filho sobe como está
+    ABRIR_LISTA,    // Primeira regra de uma lista: começa com os filhos
+    ESTENDER_LISTA, // X -> X ...: acrescenta os outros filhos à lista
+};
+
+// Profundidade reservada de antemão; programas reais raramente passam disso
+const size_t CAPACIDADE_INICIAL_PILHA = 4096;
+
+/*
+    Pilha de estados do parser: um bloco contíguo reservado de antemão e
+    reaproveitado entre execuções. Só cresce (dobrando) quando a entrada
+    aninha mais fundo do que tudo que já foi visto, então o laço do PARSE
+    não aloca nada
+*/
+class PilhaLR
+{
+public:
+    explicit PilhaLR(size_t capacidade = CAPACIDADE_INICIAL_PILHA) : dados(capacidade) {}
+
+    void limpar() { altura = 0; }
+    size_t tamanho() const { return altura; }
+
+    int topo() const { return dados[altura - 1]; }
+
+    // Os n elementos do topo, do mais fundo para o topo
+    int *ultimos(size_t n) { return dados.data() + altura - n; }
+
+    void empilhar(int estado)
+    {
+        if (altura == dados.size())
+            dados.resize(dados.size() * 2);
+
+        dados[altura++] = estado;
+    }
+
+    void desempilhar(size_t n) { altura -= n; }
+
+private:
+    vector<int> dados;
+    size_t altura = 0;
+};
+
+// Compilando com -DCEPE_TABELAS_GERADAS, as tabelas vêm do cabeçalho criado
+// por "parser --gerar tabelas_cepe.h" (veja o Makefile) e nem a gramática é lida ao rodar
+#ifdef CEPE_TABELAS_GERADAS
+#include "tabelas_cepe.h"
+
+static_assert(HASH_TOKENS_GERADO == hashTokens(), "tabelas_cepe.h é de outro lexer; rode make para gerá-lo de novo");
+static_assert(sizeof(colunaTerminalGerada) / sizeof(colunaTerminalGerada[0]) == FIM_TOKENS + 1, "tabelas_cepe.h é de outro lexer");
+
+/*
+    Como o PARSE consulta as tabelas e as regras. Ele é um template sobre
+    isso para que, com as tabelas geradas em C++, os tamanhos e os dados
+    sejam constantes e o compilador especialize o laço
+*/
+struct TabelasCompiladas
+{
+    static int32_t acao(int estado, int token) { return actionGerada[estado * NUM_COLUNAS_GERADAS + colunaTerminalGerada[token + 1]]; }
+    static int desvio(int estado, int naoTerminal) { return gotoGerado[estado * NUM_NAO_TERMINAIS_GERADOS + naoTerminal - NUM_COLUNAS_GERADAS]; }
+    static int ladoEsquerdo(int regra) { return ladoEsquerdoGerado[regra]; }
+    static int tamanhoCorpo(int regra) { return tamanhoCorpoGerado[regra]; }
+    static AcaoSemantica acaoSemantica(int regra) { return AcaoSemantica(acaoSemanticaGerada[regra]); }
+};
+#endif
+
+// Ações do PARSE quando só interessa saber se a entrada é válida
+struct SemAcoes
+{
+    void comecar() {}
+    void shift(const Token &) {}
+    void reduce(int, int, int, AcaoSemantica) {}
+    void aceitar() {}
+};
+
+/*
+    Reconhece a entrada inteira, puxando os tokens direto do lexer. Retorna
+    se ela foi aceita; num erro de sintaxe, erro fica com o token em que o
+    parser parou. Cada shift e cada reduce são repassados para acoes, que
+    monta o que quiser com eles (a árvore de ast.h, por exemplo).
+
+    A pilha só guarda estados: o símbolo de cada estado é implícito na
+    tabela, e depois de um reduce o estado novo vem do GOTO do estado
+    que ficou no topo
+*/
+template <typename Tabelas, typename Acoes>
+bool PARSE(Lexer &lexer, PilhaLR &pilha, Token &erro, Acoes &acoes)
+{
+    CEPE_FASE(FASE_PARSE);
+
+    pilha.limpar();
+    pilha.empilhar(0); // Começamos no estado 0
+    acoes.comecar();
+
+    Token tk = lexer.proximo();
+
+    while (true)
+    {
+        const int32_t acao = Tabelas::acao(pilha.topo(), tk.tipo);
+
+        switch (tipoAcao(acao))
+        {
+        case ERRO:
+            erro = tk;
+            return false;
+
+        case ACEITAR:
+            acoes.aceitar();
+            return true;
+
+        case SHIFT:
+            pilha.empilhar(alvoAcao(acao));
+            CEPE_CONTAR(SHIFTS);
+            CEPE_MAXIMO(PROFUNDIDADE_PILHA, pilha.tamanho());
+            acoes.shift(tk);
+            tk = lexer.proximo();
+            break;
+
+        case REDUCE:
+        {
+            // Desempilha o corpo da regra e desvia pelo não terminal formado
+            const int regra = alvoAcao(acao);
+            const int ladoEsquerdo = Tabelas::ladoEsquerdo(regra);
+            const int tamanho = Tabelas::tamanhoCorpo(regra);
+
+            acoes.reduce(regra, ladoEsquerdo, tamanho, Tabelas::acaoSemantica(regra));
+            pilha.desempilhar(tamanho);
+            pilha.empilhar(Tabelas::desvio(pilha.topo(), ladoEsquerdo));
+            CEPE_CONTAR(REDUCES);
+            CEPE_MAXIMO(PROFUNDIDADE_PILHA, pilha.tamanho());
+            break;
+        }
+        }
+    }
+}
+
+template <typename Tabelas>
+bool PARSE(Lexer &lexer, PilhaLR &pilha, Token &erro)
+{
+    SemAcoes nenhuma;
+    return PARSE<Tabelas>(lexer, pilha, erro, nenhuma);
+}
+
+#endif
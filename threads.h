@@ -0,0 +1,216 @@
+/*
+    Pool de threads simples para as partes paralelas do compilador.
+    As threads são criadas uma vez só e reaproveitadas a cada paraCada()
+    ou paraCadaRoubando()
+*/
+
+#ifndef CEPE_THREADS_H
+#define CEPE_THREADS_H
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+class PoolThreads
+{
+public:
+    // numThreads conta também a thread que chama paraCada()
+    explicit PoolThreads(int numThreads = thread::hardware_concurrency())
+    {
+        if (numThreads < 1)
+            numThreads = 1;
+
+        faixas = vector<Faixa>(numThreads);
+
+        for (int i = 1; i < numThreads; i++)
+            trabalhadores.emplace_back([this, i]
+                                       { laco(i); });
+    }
+
+    PoolThreads(const PoolThreads &) = delete;
+    PoolThreads &operator=(const PoolThreads &) = delete;
+
+    ~PoolThreads()
+    {
+        {
+            lock_guard<mutex> trava(mtx);
+            encerrar = true;
+        }
+        cv.notify_all();
+
+        for (thread &t : trabalhadores)
+            t.join();
+    }
+
+    int tamanho() const { return trabalhadores.size() + 1; }
+
+    // Executa tarefa(i) para todo i em [0, n), distribuindo os índices entre
+    // as threads, e só retorna quando todos tiverem terminado
+    void paraCada(int n, const function<void(int)> &tarefa)
+    {
+        if (n <= 0)
+            return;
+
+        totalTarefas = n;
+        proximaTarefa = 0;
+
+        rodarEmTodas([&](int)
+                     {
+                         for (int i = proximaTarefa++; i < totalTarefas; i = proximaTarefa++)
+                             tarefa(i); });
+    }
+
+    /*
+        Executa tarefa(i, thread) para todo i em [0, n), com roubo de trabalho:
+        cada thread começa com uma faixa contígua de índices e, quando a sua
+        acaba, rouba a metade final da faixa de outra. thread vai de 0 a
+        tamanho() - 1 e identifica quem está executando, para que cada uma
+        use as suas próprias estruturas
+    */
+    void paraCadaRoubando(int n, const function<void(int, int)> &tarefa)
+    {
+        if (n <= 0)
+            return;
+
+        const int numThreads = tamanho();
+        for (int t = 0; t < numThreads; t++)
+        {
+            faixas[t].inicio = int64_t(n) * t / numThreads;
+            faixas[t].fim = int64_t(n) * (t + 1) / numThreads;
+        }
+
+        rodarEmTodas([&](int thread)
+                     {
+                         for (int i = pegar(thread); i >= 0; i = pegar(thread))
+                             tarefa(i, thread); });
+    }
+
+private:
+    vector<thread> trabalhadores;
+
+    mutex mtx;
+    condition_variable cv;
+    condition_variable cvFim;
+    bool encerrar = false;
+    unsigned geracao = 0;
+    int ativos = 0; // Threads trabalhando na tarefa atual
+
+    // O que cada thread roda na tarefa atual, recebendo o número da thread
+    const function<void(int)> *tarefaAtual = nullptr;
+
+    // paraCada: o próximo índice é de quem pegar primeiro
+    int totalTarefas = 0;
+    atomic<int> proximaTarefa{0};
+
+    // paraCadaRoubando: índices [inicio, fim) ainda não pegos de cada thread.
+    // A dona pega do começo e quem rouba leva do fim
+    struct alignas(64) Faixa
+    {
+        mutex mtx;
+        int inicio = 0;
+        int fim = 0;
+    };
+
+    vector<Faixa> faixas;
+
+    // Roda corpo em todas as threads (a que chama é a 0) e espera todas terminarem
+    void rodarEmTodas(const function<void(int)> &corpo)
+    {
+        {
+            lock_guard<mutex> trava(mtx);
+            tarefaAtual = &corpo;
+            geracao++;
+        }
+        cv.notify_all();
+
+        corpo(0);
+
+        // Todo o trabalho já foi pego; falta esperar quem ainda está trabalhando
+        unique_lock<mutex> trava(mtx);
+        cvFim.wait(trava, [this]
+                   { return ativos == 0; });
+        tarefaAtual = nullptr;
+    }
+
+    // Próximo índice para a thread: da própria faixa ou, se ela acabou, da
+    // metade final da faixa de outra. -1 quando não sobrou nada em lugar nenhum
+    int pegar(int thread)
+    {
+        Faixa &propria = faixas[thread];
+
+        {
+            lock_guard<mutex> trava(propria.mtx);
+            if (propria.inicio < propria.fim)
+                return propria.inicio++;
+        }
+
+        const int numThreads = faixas.size();
+        for (int k = 1; k < numThreads; k++)
+        {
+            Faixa &vitima = faixas[(thread + k) % numThreads];
+            int inicio, fim;
+
+            {
+                lock_guard<mutex> trava(vitima.mtx);
+                if (vitima.inicio >= vitima.fim)
+                    continue;
+
+                // Deixa a primeira metade (que a dona já vai pegar) e leva o resto
+                fim = vitima.fim;
+                inicio = vitima.inicio + (vitima.fim - vitima.inicio) / 2;
+                vitima.fim = inicio;
+            }
+
+            // Fica com o primeiro índice roubado e guarda o resto como faixa própria
+            lock_guard<mutex> trava(propria.mtx);
+            propria.inicio = inicio + 1;
+            propria.fim = fim;
+            return inicio;
+        }
+
+        return -1;
+    }
+
+    void laco(int thread)
+    {
+        unsigned vista = 0;
+
+        while (true)
+        {
+            const function<void(int)> *corpo;
+
+            {
+                unique_lock<mutex> trava(mtx);
+                cv.wait(trava, [&]
+                        { return encerrar || geracao != vista; });
+
+                if (encerrar)
+                    return;
+
+                vista = geracao;
+
+                // A tarefa pode já ter terminado antes desta thread acordar
+                if (tarefaAtual == nullptr)
+                    continue;
+
+                corpo = tarefaAtual;
+                ativos++;
+            }
+
+            (*corpo)(thread);
+
+            {
+                lock_guard<mutex> trava(mtx);
+                ativos--;
+            }
+            cvFim.notify_all();
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,290 @@
+/*
+    Rotinas de varredura rápida usadas pelo lexer.
+
+    Cada rotina acha o fim de uma sequência de bytes de uma mesma classe
+    (espaços, dígitos, letras e dígitos ASCII, conteúdo de string) olhando 16
+    ou 32 bytes de uma vez com SSE2/AVX2. Bytes não-ASCII sempre interrompem
+    as sequências, para que só eles passem pela decodificação de UTF-8.
+    A versão AVX2 é escolhida em tempo de execução se o processador
+    suportar; fora de x86 (ou sem GCC/Clang) ficam só as versões escalares,
+    que dão exatamente o mesmo resultado
+*/
+
+#ifndef CEPE_VARREDURA_H
+#define CEPE_VARREDURA_H
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) && defined(__SSE2__)
+#define CEPE_VARREDURA_SIMD 1
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+// ===== VERSÕES ESCALARES =====
+
+// Pula espaços, tabs e quebras de linha
+inline const char *pularEspacosEscalar(const char *p, const char *fim)
+{
+    while (p < fim && (*p == ' ' || *p == '\t' || *p == '\n'))
+        p++;
+    return p;
+}
+
+inline bool ehDigitoAscii(unsigned char c) { return unsigned(c - '0') < 10; }
+inline bool ehLetraAscii(unsigned char c) { return unsigned((c | 0x20) - 'a') < 26; }
+
+inline const char *fimDigitosEscalar(const char *p, const char *fim)
+{
+    while (p < fim && ehDigitoAscii(*p))
+        p++;
+    return p;
+}
+
+inline const char *fimAlfanumericoEscalar(const char *p, const char *fim)
+{
+    while (p < fim && (ehLetraAscii(*p) || ehDigitoAscii(*p)))
+        p++;
+    return p;
+}
+
+// Acha a aspa que fecha a string (ou o fim da entrada)
+inline const char *fimStringEscalar(const char *p, const char *fim)
+{
+    while (p < fim && *p != '"')
+        p++;
+    return p;
+}
+
+// Tamanho da sequência UTF-8 bem formada que começa em p (2 a 4 bytes),
+// ou 0 se os bytes em p não formam um caractere não-ASCII válido
+inline int tamanhoUtf8(const char *p, const char *fim)
+{
+    const unsigned char c0 = p[0];
+    const long disponivel = fim - p;
+
+    auto continuacao = [](unsigned char c)
+    { return (c & 0xC0) == 0x80; };
+
+    if (c0 >= 0xC2 && c0 <= 0xDF)
+        return disponivel >= 2 && continuacao(p[1]) ? 2 : 0;
+
+    if (c0 >= 0xE0 && c0 <= 0xEF)
+    {
+        if (disponivel < 3)
+            return 0;
+
+        const unsigned char c1 = p[1];
+        // Sem formas longas demais (E0) nem surrogates (ED)
+        const bool segundoOk = c0 == 0xE0 ? (c1 >= 0xA0 && c1 <= 0xBF) : c0 == 0xED ? (c1 >= 0x80 && c1 <= 0x9F)
+                                                                                     : continuacao(c1);
+        return segundoOk && continuacao(p[2]) ? 3 : 0;
+    }
+
+    if (c0 >= 0xF0 && c0 <= 0xF4)
+    {
+        if (disponivel < 4)
+            return 0;
+
+        const unsigned char c1 = p[1];
+        // Sem formas longas demais (F0) nem nada acima de U+10FFFF (F4)
+        const bool segundoOk = c0 == 0xF0 ? (c1 >= 0x90 && c1 <= 0xBF) : c0 == 0xF4 ? (c1 >= 0x80 && c1 <= 0x8F)
+                                                                                     : continuacao(c1);
+        return segundoOk && continuacao(p[2]) && continuacao(p[3]) ? 4 : 0;
+    }
+
+    return 0;
+}
+
+#ifdef CEPE_VARREDURA_SIMD
+
+// ===== VERSÕES SSE2 (16 bytes por vez) =====
+
+inline const char *pularEspacosSSE2(const char *p, const char *fim)
+{
+    const __m128i espaco = _mm_set1_epi8(' ');
+    const __m128i tab = _mm_set1_epi8('\t');
+    const __m128i quebra = _mm_set1_epi8('\n');
+
+    while (fim - p >= 16)
+    {
+        const __m128i v = _mm_loadu_si128((const __m128i *)p);
+        const __m128i brancos = _mm_or_si128(_mm_cmpeq_epi8(v, espaco),
+                                             _mm_or_si128(_mm_cmpeq_epi8(v, tab), _mm_cmpeq_epi8(v, quebra)));
+        const unsigned outros = ~_mm_movemask_epi8(brancos) & 0xFFFF;
+
+        if (outros != 0)
+            return p + __builtin_ctz(outros);
+        p += 16;
+    }
+
+    return pularEspacosEscalar(p, fim);
+}
+
+// Máscara dos bytes c com lo <= c <= hi
+inline __m128i faixaSSE2(__m128i v, char lo, char hi)
+{
+    const __m128i t = _mm_sub_epi8(v, _mm_set1_epi8(lo));
+    return _mm_cmpeq_epi8(_mm_min_epu8(t, _mm_set1_epi8(hi - lo)), t);
+}
+
+inline const char *fimDigitosSSE2(const char *p, const char *fim)
+{
+    while (fim - p >= 16)
+    {
+        const __m128i v = _mm_loadu_si128((const __m128i *)p);
+        const unsigned fora = ~_mm_movemask_epi8(faixaSSE2(v, '0', '9')) & 0xFFFF;
+
+        if (fora != 0)
+            return p + __builtin_ctz(fora);
+        p += 16;
+    }
+
+    return fimDigitosEscalar(p, fim);
+}
+
+inline const char *fimAlfanumericoSSE2(const char *p, const char *fim)
+{
+    const __m128i minuscula = _mm_set1_epi8(0x20);
+
+    while (fim - p >= 16)
+    {
+        const __m128i v = _mm_loadu_si128((const __m128i *)p);
+        const __m128i letra = faixaSSE2(_mm_or_si128(v, minuscula), 'a', 'z');
+        const __m128i digito = faixaSSE2(v, '0', '9');
+        const unsigned fora = ~_mm_movemask_epi8(_mm_or_si128(letra, digito)) & 0xFFFF;
+
+        if (fora != 0)
+            return p + __builtin_ctz(fora);
+        p += 16;
+    }
+
+    return fimAlfanumericoEscalar(p, fim);
+}
+
+inline const char *fimStringSSE2(const char *p, const char *fim)
+{
+    const __m128i aspa = _mm_set1_epi8('"');
+
+    while (fim - p >= 16)
+    {
+        const __m128i v = _mm_loadu_si128((const __m128i *)p);
+        const unsigned achou = _mm_movemask_epi8(_mm_cmpeq_epi8(v, aspa));
+
+        if (achou != 0)
+            return p + __builtin_ctz(achou);
+        p += 16;
+    }
+
+    return fimStringEscalar(p, fim);
+}
+
+// ===== VERSÕES AVX2 (32 bytes por vez) =====
+
+__attribute__((target("avx2"))) inline const char *pularEspacosAVX2(const char *p, const char *fim)
+{
+    const __m256i espaco = _mm256_set1_epi8(' ');
+    const __m256i tab = _mm256_set1_epi8('\t');
+    const __m256i quebra = _mm256_set1_epi8('\n');
+
+    while (fim - p >= 32)
+    {
+        const __m256i v = _mm256_loadu_si256((const __m256i *)p);
+        const __m256i brancos = _mm256_or_si256(_mm256_cmpeq_epi8(v, espaco),
+                                                _mm256_or_si256(_mm256_cmpeq_epi8(v, tab), _mm256_cmpeq_epi8(v, quebra)));
+        const unsigned outros = ~(unsigned)_mm256_movemask_epi8(brancos);
+
+        if (outros != 0)
+            return p + __builtin_ctz(outros);
+        p += 32;
+    }
+
+    return pularEspacosSSE2(p, fim);
+}
+
+__attribute__((target("avx2"))) inline __m256i faixaAVX2(__m256i v, char lo, char hi)
+{
+    const __m256i t = _mm256_sub_epi8(v, _mm256_set1_epi8(lo));
+    return _mm256_cmpeq_epi8(_mm256_min_epu8(t, _mm256_set1_epi8(hi - lo)), t);
+}
+
+__attribute__((target("avx2"))) inline const char *fimDigitosAVX2(const char *p, const char *fim)
+{
+    while (fim - p >= 32)
+    {
+        const __m256i v = _mm256_loadu_si256((const __m256i *)p);
+        const unsigned fora = ~(unsigned)_mm256_movemask_epi8(faixaAVX2(v, '0', '9'));
+
+        if (fora != 0)
+            return p + __builtin_ctz(fora);
+        p += 32;
+    }
+
+    return fimDigitosSSE2(p, fim);
+}
+
+__attribute__((target("avx2"))) inline const char *fimAlfanumericoAVX2(const char *p, const char *fim)
+{
+    const __m256i minuscula = _mm256_set1_epi8(0x20);
+
+    while (fim - p >= 32)
+    {
+        const __m256i v = _mm256_loadu_si256((const __m256i *)p);
+        const __m256i letra = faixaAVX2(_mm256_or_si256(v, minuscula), 'a', 'z');
+        const __m256i digito = faixaAVX2(v, '0', '9');
+        const unsigned fora = ~(unsigned)_mm256_movemask_epi8(_mm256_or_si256(letra, digito));
+
+        if (fora != 0)
+            return p + __builtin_ctz(fora);
+        p += 32;
+    }
+
+    return fimAlfanumericoSSE2(p, fim);
+}
+
+__attribute__((target("avx2"))) inline const char *fimStringAVX2(const char *p, const char *fim)
+{
+    const __m256i aspa = _mm256_set1_epi8('"');
+
+    while (fim - p >= 32)
+    {
+        const __m256i v = _mm256_loadu_si256((const __m256i *)p);
+        const unsigned achou = _mm256_movemask_epi8(_mm256_cmpeq_epi8(v, aspa));
+
+        if (achou != 0)
+            return p + __builtin_ctz(achou);
+        p += 32;
+    }
+
+    return fimStringSSE2(p, fim);
+}
+
+#endif
+
+// ===== ESCOLHA EM TEMPO DE EXECUÇÃO =====
+
+struct RotinasVarredura
+{
+    const char *(*pularEspacos)(const char *, const char *);
+    const char *(*fimDigitos)(const char *, const char *);
+    const char *(*fimAlfanumerico)(const char *, const char *);
+    const char *(*fimString)(const char *, const char *);
+    const char *nome;
+};
+
+inline RotinasVarredura escolherRotinasVarredura()
+{
+#ifdef CEPE_VARREDURA_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        return {pularEspacosAVX2, fimDigitosAVX2, fimAlfanumericoAVX2, fimStringAVX2, "avx2"};
+
+    return {pularEspacosSSE2, fimDigitosSSE2, fimAlfanumericoSSE2, fimStringSSE2, "sse2"};
+#else
+    return {pularEspacosEscalar, fimDigitosEscalar, fimAlfanumericoEscalar, fimStringEscalar, "escalar"};
+#endif
+}
+
+// Escolhidas uma vez só, na inicialização do programa
+inline const RotinasVarredura varredura = escolherRotinasVarredura();
+
+#endif